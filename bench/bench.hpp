@@ -0,0 +1,61 @@
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Keeps the compiler from dropping a computation whose result is unused.
+// Objects larger than a register are only referenced in place, "r,m" would
+// have the compiler copy them and time the copy.
+template <typename T> inline void DoNotOptimize(const T &value) {
+#if defined(__GNUC__) || defined(__clang__)
+  if (sizeof(T) <= sizeof(uint64_t)) {
+    asm volatile("" : : "r,m"(value) : "memory");
+  } else {
+    asm volatile("" : : "m"(value) : "memory");
+  }
+#else
+  volatile T sink = value;
+  (void)sink;
+#endif
+}
+
+// One line of the report: a name and its measured values
+struct BenchRecord {
+  std::string name;
+  std::vector<std::pair<std::string, double>> metrics;
+};
+
+class BenchRunner {
+public:
+  double sampleSeconds; // Target duration of one timed sample
+  int samples;          // Samples per benchmark, the fastest one is kept
+  uint32_t macroFrames; // Frames per headless ROM run
+  std::string filter;   // Only names containing it run
+  std::vector<BenchRecord> records;
+
+  BenchRunner();
+
+  bool Selected(const std::string &name) const;
+
+  // Times body(n), which must perform n operations, and records ns/op.
+  // n is grown until a sample takes sampleSeconds.
+  void Micro(const std::string &name,
+             const std::function<void(uint64_t)> &body);
+
+  void Add(const BenchRecord &record);
+
+  void WriteJson(std::ostream &out) const;
+};
+
+// Monotonic time in seconds
+double Now();
+
+void RegisterMicroBenchmarks(BenchRunner &runner);
+void RegisterMacroBenchmarks(BenchRunner &runner);
+
+#endif // BENCH_HPP
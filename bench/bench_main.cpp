@@ -0,0 +1,115 @@
+#include "bench.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+double Now() {
+  return std::chrono::duration<double>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+BenchRunner::BenchRunner()
+    : sampleSeconds(0.05), samples(5), macroFrames(20000) {}
+
+bool BenchRunner::Selected(const std::string &name) const {
+  return name.find(filter) != std::string::npos;
+}
+
+void BenchRunner::Micro(const std::string &name,
+                        const std::function<void(uint64_t)> &body) {
+  if (!Selected(name)) {
+    return;
+  }
+
+  // Calibration: doubles n until one run is long enough to time reliably
+  uint64_t n = 1;
+  for (;;) {
+    double start = Now();
+    body(n);
+    double elapsed = Now() - start;
+    if (elapsed >= sampleSeconds || n >= (1ull << 40)) {
+      break;
+    }
+    n *= elapsed > sampleSeconds / 16 ? 2 : 8;
+  }
+
+  double best = 1e300;
+  for (int i = 0; i < samples; i++) {
+    double start = Now();
+    body(n);
+    best = std::min(best, Now() - start);
+  }
+
+  Add({name, {{"ns_per_op", best * 1e9 / n}, {"ops", double(n)}}});
+}
+
+void BenchRunner::Add(const BenchRecord &record) {
+  records.push_back(record);
+
+  // Progress on stderr, the report on stdout stays valid JSON
+  std::cerr << std::left << std::setw(40) << record.name;
+  for (const auto &metric : record.metrics) {
+    std::cerr << " " << metric.first << "=" << metric.second;
+  }
+  std::cerr << "\n";
+}
+
+void BenchRunner::WriteJson(std::ostream &out) const {
+  out << "{\n  \"benchmarks\": [\n";
+  for (size_t i = 0; i < records.size(); i++) {
+    out << "    {\"name\": \"" << records[i].name << "\"";
+    for (const auto &metric : records[i].metrics) {
+      out << ", \"" << metric.first << "\": " << std::setprecision(6)
+          << metric.second;
+    }
+    out << "}" << (i + 1 < records.size() ? "," : "") << "\n";
+  }
+  out << "  ]\n}\n";
+}
+
+static void PrintUsage(const char *program) {
+  std::cout << "Usage: " << program << " [options]\n"
+            << "   --filter TEXT  Only run benchmarks whose name contains TEXT\n"
+            << "   --quick        Shorter samples, for smoke testing\n"
+            << "   --out FILE     Write the JSON report to FILE (default: stdout)\n";
+}
+
+int main(int argc, char **argv) {
+  BenchRunner runner;
+  const char *outFile = nullptr;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+      runner.filter = argv[++i];
+    } else if (strcmp(argv[i], "--quick") == 0) {
+      runner.sampleSeconds = 0.005;
+      runner.samples = 1;
+      runner.macroFrames = 500;
+    } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+      outFile = argv[++i];
+    } else {
+      PrintUsage(argv[0]);
+      return 1;
+    }
+  }
+
+  RegisterMicroBenchmarks(runner);
+  RegisterMacroBenchmarks(runner);
+
+  if (outFile) {
+    std::ofstream file(outFile);
+    if (!file) {
+      std::cout << "Error while opening the report file\n";
+      return 1;
+    }
+    runner.WriteJson(file);
+  } else {
+    runner.WriteJson(std::cout);
+  }
+  return 0;
+}
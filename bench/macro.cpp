@@ -0,0 +1,185 @@
+#include "bench.hpp"
+#include "chip8.hpp"
+#include "ensemble.hpp"
+#include "vec_env.hpp"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Rom {
+  const char *name;
+  std::vector<uint8_t> code;
+};
+
+// Synthetic ROMs stressing different parts of the interpreter; they loop
+// forever, so any frame count works
+const Rom ROMS[] = {
+    // Register arithmetic with a skip and jumps
+    {"arith",
+     {0x60, 0x00,   // 200: V0 <- 0
+      0x61, 0x01,   // 202: V1 <- 1
+      0x80, 0x14,   // 204: V0 += V1
+      0x81, 0x05,   // 206: V1 -= V0
+      0x72, 0x03,   // 208: V2 += 3
+      0x83, 0x26,   // 20A: V3 <- V2 >> 1
+      0x32, 0x00,   // 20C: skip if V2 == 0
+      0x12, 0x04,   // 20E: JP 204
+      0x12, 0x00}}, // 210: JP 200
+
+    // Font sprites drawn across the screen, cleared every 16
+    {"sprites",
+     {0x60, 0x00,   // 200: V0 <- 0
+      0x61, 0x00,   // 202: V1 <- 0
+      0x62, 0x00,   // 204: V2 <- 0
+      0xF2, 0x29,   // 206: I <- font(V2)
+      0xD0, 0x15,   // 208: draw at V0, V1
+      0x70, 0x05,   // 20A: V0 += 5
+      0x71, 0x03,   // 20C: V1 += 3
+      0x72, 0x01,   // 20E: V2 += 1
+      0x42, 0x10,   // 210: skip if V2 != 16
+      0x00, 0xE0,   // 212: CLS
+      0x42, 0x10,   // 214: skip if V2 != 16
+      0x62, 0x00,   // 216: V2 <- 0
+      0x12, 0x06}}, // 218: JP 206
+
+    // Random numbers, BCD, register loads and stores, calls and draws
+    {"mixed",
+     {0xA3, 0x00,   // 200: I <- 300
+      0xC0, 0xFF,   // 202: V0 <- rand
+      0xF0, 0x33,   // 204: BCD of V0 at I
+      0xF2, 0x65,   // 206: V0..V2 <- [I]
+      0x22, 0x10,   // 208: CALL 210
+      0xF2, 0x55,   // 20A: [I] <- V0..V2
+      0x12, 0x02,   // 20C: JP 202
+      0x00, 0x00,   // 20E: (unused)
+      0xF0, 0x29,   // 210: I <- font(V0)
+      0xD1, 0x25,   // 212: draw at V1, V2
+      0xA3, 0x00,   // 214: I <- 300
+      0x00, 0xEE}}, // 216: RET
+
+    // A frame counter paced by polling the delay timer, like most games
+    {"idle",
+     {0x60, 0x02,   // 200: V0 <- 2
+      0xF0, 0x15,   // 202: DT <- V0
+      0xF1, 0x07,   // 204: V1 <- DT
+      0x31, 0x00,   // 206: skip if V1 == 0
+      0x12, 0x04,   // 208: JP 204
+      0x72, 0x01,   // 20A: V2 += 1
+      0x12, 0x00}}, // 20C: JP 200
+};
+
+const uint32_t INSTRUCTIONS_PER_FRAME = 1000;
+
+// Ensemble runs: instances per run, and frames relative to single runs
+const uint32_t ENSEMBLE_INSTANCES = 1024;
+const uint32_t ENSEMBLE_FRAME_DIVISOR = 100;
+
+// Vector environment runs: Gym-like steps of a few frames at the default
+// speed, with actions changing every step
+const uint32_t ENV_COUNT = 256;
+const uint32_t ENV_FRAMES_PER_STEP = 4;
+const uint32_t ENV_STEP_DIVISOR = 10;
+
+} // namespace
+
+void RegisterMacroBenchmarks(BenchRunner &runner) {
+  for (const Rom &rom : ROMS) {
+    for (bool useJit : {false, true}) {
+      std::string name = std::string("macro/") +
+                         (useJit ? "jit/" : "interpreter/") + rom.name;
+      if (!runner.Selected(name) || (useJit && !Jit::IsSupported())) {
+        continue;
+      }
+
+      std::unique_ptr<CHIP8> chip8(new CHIP8);
+      chip8->instructionsPerFrame = INSTRUCTIONS_PER_FRAME;
+      chip8->UseJit(useJit);
+      memcpy(&chip8->memory[0x200], rom.code.data(), rom.code.size());
+      chip8->interpreter.InvalidateCache(0x200, rom.code.size());
+
+      double start = Now();
+      chip8->RunFrames(runner.macroFrames);
+      double seconds = Now() - start;
+
+      double instructions = chip8->cycleCount;
+      runner.Add({name,
+                  {{"frames", double(runner.macroFrames)},
+                   {"instructions", instructions},
+                   {"seconds", seconds},
+                   {"mips", instructions / seconds / 1e6},
+                   {"ns_per_instruction", seconds * 1e9 / instructions}}});
+    }
+  }
+
+  // Same ROMs on many instances at once, each with its own CXNN seed
+  for (bool vector : {false, true}) {
+    for (const Rom &rom : ROMS) {
+      std::string name = std::string("macro/ensemble/") +
+                         (vector ? "vector/" : "scalar/") + rom.name;
+      Ensemble ensemble(ENSEMBLE_INSTANCES);
+      if (!runner.Selected(name) || !ensemble.UseVectorKernels(vector)) {
+        continue;
+      }
+
+      ensemble.instructionsPerFrame = INSTRUCTIONS_PER_FRAME;
+      ensemble.LoadRom(rom.code.data(), rom.code.size());
+      for (uint32_t i = 0; i < ENSEMBLE_INSTANCES; i++) {
+        ensemble.Seed(i, i);
+      }
+
+      uint32_t frames =
+          std::max<uint32_t>(1, runner.macroFrames / ENSEMBLE_FRAME_DIVISOR);
+      double start = Now();
+      ensemble.RunFrames(frames);
+      double seconds = Now() - start;
+
+      double instructions = ensemble.lockstepInstructions +
+                            ensemble.scalarInstructions +
+                            ensemble.idleInstructions;
+      runner.Add({name,
+                  {{"frames", double(frames)},
+                   {"instances", double(ENSEMBLE_INSTANCES)},
+                   {"instructions", instructions},
+                   {"lockstep_share",
+                    ensemble.lockstepInstructions / instructions},
+                   {"seconds", seconds},
+                   {"mips", instructions / seconds / 1e6},
+                   {"ns_per_instruction", seconds * 1e9 / instructions}}});
+    }
+  }
+
+  for (const Rom &rom : ROMS) {
+    std::string name = std::string("macro/vec_env/") + rom.name;
+    if (!runner.Selected(name)) {
+      continue;
+    }
+
+    VecEnv vec(ENV_COUNT);
+    vec.LoadRom(rom.code.data(), rom.code.size());
+    vec.Reset(0);
+
+    std::vector<uint16_t> actions(ENV_COUNT);
+    uint32_t steps = std::max<uint32_t>(1, runner.macroFrames / ENV_STEP_DIVISOR);
+    double start = Now();
+    for (uint32_t step = 0; step < steps; step++) {
+      for (uint32_t i = 0; i < ENV_COUNT; i++) {
+        actions[i] = 1 << ((i + step) % 16);
+      }
+      vec.Step(actions.data(), ENV_FRAMES_PER_STEP);
+      DoNotOptimize(vec.Observe(0)[0]);
+    }
+    double seconds = Now() - start;
+
+    double envSteps = double(steps) * ENV_COUNT;
+    runner.Add({name,
+                {{"environments", double(ENV_COUNT)},
+                 {"frames_per_step", double(ENV_FRAMES_PER_STEP)},
+                 {"steps", envSteps},
+                 {"seconds", seconds},
+                 {"steps_per_second", envSteps / seconds}}});
+  }
+}
@@ -0,0 +1,158 @@
+#include "bench.hpp"
+#include "chip8.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct OpcodeCase {
+  const char *name;
+  uint16_t opcode;
+};
+
+// One representative per handler family
+const OpcodeCase OPCODES[] = {
+    {"ld_byte", 0x6A42},   {"add_byte", 0x7A01}, {"alu_or", 0x8AB1},
+    {"alu_add", 0x8AB4},   {"alu_sub", 0x8AB5},  {"alu_shift", 0x8AB6},
+    {"skip", 0x3A00},      {"jump", 0x1300},     {"ld_i", 0xA300},
+    {"add_i", 0xFA1E},     {"rnd", 0xCAFF},      {"font", 0xFA29},
+    {"bcd", 0xFA33},       {"store_regs", 0xF755}, {"load_regs", 0xF765},
+    {"timer", 0xFA15},     {"key_skip", 0xEA9E}, {"draw", 0xD125},
+};
+
+struct SpriteCase {
+  const char *name;
+  uint8_t x, y;
+  bool collide;
+};
+
+const SpriteCase SPRITES[] = {
+    {"aligned", 16, 8, false},
+    {"unaligned", 13, 8, false},
+    {"clipped", 60, 29, false},
+    {"colliding", 13, 8, true},
+};
+
+} // namespace
+
+void RegisterMicroBenchmarks(BenchRunner &runner) {
+  std::unique_ptr<CHIP8> chip8(new CHIP8);
+  CHIP8 &c = *chip8;
+  Interpreter &cpu = c.interpreter;
+
+  for (const OpcodeCase &op : OPCODES) {
+    runner.Micro(std::string("micro/execute/") + op.name, [&](uint64_t n) {
+      for (uint64_t i = 0; i < n; i++) {
+        cpu.pc = 0x200; // Jumps, skips and FX55/FX65 move these
+        cpu.I = 0x300;
+        cpu.DecodeAndExecute(op.opcode);
+      }
+      DoNotOptimize(cpu.V);
+    });
+  }
+
+  uint8_t sprite[] = {0xF0, 0x90, 0xF0, 0x90, 0xF0};
+  for (const SpriteCase &sc : SPRITES) {
+    runner.Micro(std::string("micro/draw_sprite/") + sc.name, [&](uint64_t n) {
+      int rows = std::min<int>(5, Screen::Y_TILES - sc.y);
+      for (uint64_t i = 0; i < n; i++) {
+        // Same number of stores either way, only the collision differs
+        for (int r = 0; r < rows; r++) {
+          c.screen.buffer[sc.y + r] = sc.collide ? ~0ull : 0;
+        }
+        c.screen.drawSprite(sc.x, sc.y, 5, sprite);
+      }
+      DoNotOptimize(c.screen.buffer);
+    });
+  }
+
+  const uint32_t palette[4] = {0xFF000000, 0xFFFFFFFF, 0xFFFF0000,
+                               0xFF00FF00};
+  runner.Micro("micro/screen/render", [&](uint64_t n) {
+    static uint32_t pixels[Screen::Y_TILES * Screen::X_TILES];
+    for (uint64_t i = 0; i < n; i++) {
+      c.screen.buffer[i % Screen::Y_TILES] ^= i;
+      c.screen.Render(pixels, Screen::X_TILES * 4, palette);
+      DoNotOptimize(pixels);
+    }
+  });
+
+  // SUPER-CHIP hires: 16x16 sprites across the word boundary and scrolls
+  c.screen.SetHires(true);
+  uint8_t bigSprite[32];
+  std::fill(bigSprite, bigSprite + 32, 0xA5);
+  runner.Micro("micro/hires/draw_16x16", [&](uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+      c.screen.drawSprite(56, 20, 0, bigSprite);
+    }
+    DoNotOptimize(c.screen.buffer);
+  });
+
+  runner.Micro("micro/hires/scroll_down", [&](uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+      c.screen.buffer[i % Screen::BUFFER_WORDS] ^= i;
+      c.screen.ScrollDown(4);
+    }
+    DoNotOptimize(c.screen.buffer);
+  });
+
+  runner.Micro("micro/hires/scroll_right", [&](uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+      c.screen.buffer[i % Screen::BUFFER_WORDS] ^= i;
+      c.screen.ScrollRight();
+    }
+    DoNotOptimize(c.screen.buffer);
+  });
+
+  runner.Micro("micro/hires/render", [&](uint64_t n) {
+    static uint32_t pixels[Screen::HIRES_Y_TILES * Screen::HIRES_X_TILES];
+    for (uint64_t i = 0; i < n; i++) {
+      c.screen.buffer[i % Screen::BUFFER_WORDS] ^= i;
+      c.screen.Render(pixels, Screen::HIRES_X_TILES * 4, palette);
+      DoNotOptimize(pixels);
+    }
+  });
+  c.screen.SetHires(false);
+
+  runner.Micro("micro/screen/hash", [&](uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+      c.screen.buffer[i % Screen::Y_TILES] ^= i;
+      DoNotOptimize(c.screen.Hash());
+    }
+  });
+
+  // Largest ROM that fits, loaded from disk
+  const char *romPath = "build/bench_rom.ch8";
+  if (runner.Selected("micro/rom/load")) {
+    std::vector<uint8_t> rom(CHIP8::MEMORY_SIZE - 0x200, 0x12);
+    FILE *file = fopen(romPath, "wb");
+    if (file) {
+      fwrite(rom.data(), 1, rom.size(), file);
+      fclose(file);
+      runner.Micro("micro/rom/load", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; i++) {
+          DoNotOptimize(c.ReadRom(romPath));
+        }
+      });
+      remove(romPath);
+    }
+  }
+
+  MachineState state;
+  runner.Micro("micro/state/capture", [&](uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+      c.CaptureState(state);
+      DoNotOptimize(state);
+    }
+  });
+
+  runner.Micro("micro/rewind/capture", [&](uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+      c.screen.buffer[i % Screen::Y_TILES] ^= i; // Something to encode
+      c.rewind.Capture(c);
+    }
+  });
+}
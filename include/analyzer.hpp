@@ -0,0 +1,74 @@
+#ifndef ANALYZER_HPP
+#define ANALYZER_HPP
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// What the analysis found a ROM byte to be
+enum class ByteKind : uint8_t {
+  Unreached,  // Neither decoded nor accessed, data or dead code
+  Code,
+  Sprite,     // Read by DXYN
+  Data,       // Read or written by FX33, FX55, FX65, 5XY2 or 5XY3
+};
+
+// Straight-line run of instructions entered only at its start
+struct BasicBlock {
+  uint16_t start;
+  uint16_t end;                      // One past the last instruction
+  std::vector<uint16_t> successors;  // Static edges, lowest first
+  uint16_t call;                     // 2NNN target, 0 if none
+  bool indirect;                     // Ends in BNNN, target known at run time
+  bool returns;                      // Ends in 00EE
+  bool halts;                        // Ends in 00FD or a jump to itself
+};
+
+// Where control goes after one instruction
+struct Flow {
+  uint16_t length;  // 2, or 4 for F000 NNNN
+  uint16_t target;  // Jump, call or skip destination
+  bool hasTarget;
+  bool next;        // Continues with the following instruction
+};
+
+// Static analysis of a ROM image. Code is found by following every
+// control transfer from the entry point (jumps, calls, returns and both
+// sides of skips) and split into basic blocks wherever an edge lands.
+// Sprites and other data are found from constant I values (ANNN, F000
+// NNNN) reaching DXYN and the memory instructions in the same block. The
+// block boundaries and code/data map are what a block cache or an ahead
+// of time compiler would start from.
+class RomAnalysis {
+public:
+  static constexpr uint16_t ORIGIN = 0x200;  // Load address and entry
+
+  std::vector<uint8_t> image;               // ROM bytes, at ORIGIN
+  std::vector<ByteKind> kinds;              // One per image byte
+  std::map<uint16_t, BasicBlock> blocks;    // By start address
+  std::vector<uint16_t> subroutines;        // 2NNN targets, sorted
+  std::vector<uint16_t> indirectJumps;      // Addresses of BNNN
+  std::vector<uint16_t> externalTargets;    // Edges leaving the image
+
+  // False when the ROM is empty or does not fit in 64kb
+  bool Analyze(const uint8_t *rom, size_t size);
+
+  ByteKind KindAt(uint16_t address) const;  // Unreached outside the image
+  uint16_t OpcodeAt(uint16_t address) const;
+
+  // Assembly text of one instruction, e.g. "LD V1, 0x33"
+  static std::string Disassemble(uint16_t opcode, uint16_t operand = 0);
+
+  void WriteText(std::ostream &out) const;  // Listing of blocks and data
+  void WriteDot(std::ostream &out) const;   // Graphviz digraph of blocks
+
+private:
+  bool InImage(uint32_t address, uint32_t length = 2) const;
+  Flow FlowAt(uint16_t address) const;
+  void Mark(uint32_t address, uint32_t length, ByteKind kind);
+  void FindData(const BasicBlock &block);
+};
+
+#endif // ANALYZER_HPP
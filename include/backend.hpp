@@ -0,0 +1,56 @@
+#ifndef BACKEND_HPP
+#define BACKEND_HPP
+
+#include <cstdint>
+#include <string>
+
+class Screen;
+
+// Host interfaces used by the emulator core. All of them are optional:
+// a CHIP8 with no backends attached runs headless.
+
+class VideoBackend {
+public:
+  virtual ~VideoBackend() = default;
+
+  // Shows the current framebuffer
+  virtual void Present(const Screen &screen) = 0;
+
+  // Status line shown over or next to the picture, empty to clear it
+  virtual void SetOverlayText(const std::string &text) { (void)text; }
+};
+
+class AudioBackend {
+public:
+  virtual ~AudioBackend() = default;
+
+  // Turns the buzzer on or off
+  virtual void SetTone(bool on) = 0;
+
+  // XO-CHIP sample bits (F002), played at 4000 * 2^((pitch - 64) / 48)
+  // bits per second (FX3A). All zero bits mean the plain buzzer.
+  virtual void SetPattern(const uint8_t pattern[16], uint8_t pitch) {
+    (void)pattern;
+    (void)pitch;
+  }
+};
+
+class InputBackend {
+public:
+  virtual ~InputBackend() = default;
+
+  // Pumps pending host events into the keypad state
+  virtual void PollEvents() = 0;
+
+  static constexpr int32_t FOREVER = -1;
+
+  // Blocks until a host event arrives or timeoutMs pass (FOREVER waits
+  // without limit), then pumps like PollEvents(). Backends that cannot
+  // block just poll.
+  virtual void WaitEvents(int32_t timeoutMs) {
+    (void)timeoutMs;
+    PollEvents();
+  }
+};
+
+#endif // BACKEND_HPP
@@ -0,0 +1,54 @@
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+#include "chip8.hpp"
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// One headless run of the batch runner
+struct BatchJob {
+  std::string rom;
+  uint32_t frames;
+  std::string script;  // Input script, empty for none
+};
+
+struct BatchResult {
+  bool ok;
+  std::string error;
+  uint64_t cycles;
+  uint64_t framebufferHash;  // Screen::Hash() after the last frame
+  double wallSeconds;
+};
+
+struct BatchOptions {
+  bool useJit = false;
+  uint32_t instructionsPerFrame = CHIP8::CYCLES_PER_FRAME;
+  uint64_t seed = 0;  // RND seed, fixed so reruns are comparable
+  QuirkProfile quirks = QuirkProfile::CosmacVip;
+};
+
+// Manifest lines are "rom frames [script]", '#' starts a comment
+bool ReadManifest(const char *filename, std::vector<BatchJob> &jobs);
+
+// Script lines are "time key down|up", key being a hex digit. The time is
+// a frame number (the event lands on the frame's first cycle) or, written
+// "@N", an exact cycle.
+bool ReadInputScript(const char *filename, uint32_t instructionsPerFrame,
+                     std::vector<KeyEvent> &events);
+
+// Runs a job on its own CHIP8, safe to call from several threads
+BatchResult RunBatchJob(const BatchJob &job, const BatchOptions &options);
+
+// Runs every job on a work-stealing pool (0 threads: all cores)
+std::vector<BatchResult> RunBatch(const std::vector<BatchJob> &jobs,
+                                  const BatchOptions &options,
+                                  unsigned threads);
+
+void WriteCsvReport(std::ostream &out, const std::vector<BatchJob> &jobs,
+                    const std::vector<BatchResult> &results);
+void WriteJsonReport(std::ostream &out, const std::vector<BatchJob> &jobs,
+                     const std::vector<BatchResult> &results);
+
+#endif // BATCH_HPP
@@ -0,0 +1,42 @@
+#ifndef BUZZER_HPP
+#define BUZZER_HPP
+
+#include <atomic>
+#include <cstdint>
+
+// Tone synthesized on demand: a square wave, or the 128 bit XO-CHIP
+// pattern looped at its pitch once a program sets one. The emulation
+// thread switches it with SetTone()/SetPattern() and the audio thread
+// pulls samples with Fill(); the state they share is atomic, so neither
+// side ever waits. Starts and stops ramp over a few samples instead of
+// clicking.
+class Buzzer {
+public:
+  static constexpr uint32_t FREQUENCY = 440;   // Hz
+  static constexpr int16_t AMPLITUDE = 4000;
+  static constexpr int32_t RAMP_SAMPLES = 64;  // Fade in and out length
+
+  explicit Buzzer(uint32_t sampleRate);
+
+  void SetTone(bool on);     // Any thread
+  bool ToneOn() const;
+
+  // Any thread; an all zero pattern goes back to the square wave
+  void SetPattern(const uint8_t pattern[16], uint8_t pitch);
+
+  // Audio thread: the next count mono samples
+  void Fill(int16_t *samples, int count);
+
+private:
+  std::atomic<bool> on;
+  // Pattern bits, first bit in the MSB of pattern[0]; a change may reach
+  // one callback half applied, which is inaudible
+  std::atomic<uint64_t> pattern[2];
+  std::atomic<uint32_t> patternStep; // Phase advance per sample
+  uint32_t sampleRate;
+  uint32_t phase;  // Position in the period, 1 << 32 per period
+  uint32_t step;   // Phase advance per sample of the square wave
+  int32_t gain;    // 0 (silent) to RAMP_SAMPLES (full)
+};
+
+#endif // BUZZER_HPP
@@ -1,28 +1,102 @@
 #ifndef CHIP8_HPP
 #define CHIP8_HPP
 
+#include "backend.hpp"
+#include "frame_clock.hpp"
+#include "input.hpp"
 #include "interpreter.hpp"
+#include "jit.hpp"
+#include "profile.hpp"
+#include "rewind.hpp"
+#include "save_state.hpp"
+#include "telemetry.hpp"
 #include "screen.hpp"
-#include "sound.hpp"
 #include <cstdint>
+#include <memory>
+#include <string>
 
 class CHIP8 {
 public:
   static constexpr uint8_t FONT_DATA_START = 0x50;
   static constexpr uint8_t FONT_SPRITE_HEIGHT = 5;
-  static constexpr uint16_t MEMORY_SIZE = 0x1000;
+  static constexpr uint8_t BIG_FONT_DATA_START = 0xA0;  // SUPER-CHIP FX30
+  static constexpr uint8_t BIG_FONT_SPRITE_HEIGHT = 10;
+  static constexpr uint16_t MEMORY_SIZE = 0x1000;       // CHIP-8, SUPER-CHIP
+  static constexpr uint32_t MAX_MEMORY_SIZE = 0x10000;  // XO-CHIP
+  static constexpr uint32_t CYCLES_PER_FRAME = 8; // ~500 Hz at 60 Hz
+  static constexpr uint32_t FAST_FORWARD_SPEED = 10;
 
-  uint32_t frameStart;
+  // Hex digit sprites, loaded at FONT_DATA_START
+  static const uint8_t FONT_DATA[16 * FONT_SPRITE_HEIGHT];
+  static const uint8_t BIG_FONT_DATA[16 * BIG_FONT_SPRITE_HEIGHT];
 
-  uint8_t memory[MEMORY_SIZE];  // 4kb memory
+  // Emulated time: instructions executed and 60 Hz timer ticks
+  uint64_t cycleCount;
+  uint64_t frameCount;
+
+  uint32_t instructionsPerFrame; // CPU speed, CYCLES_PER_FRAME by default
+  bool turbo;                    // Emulate as fast as possible
+  bool fastForward;              // Toggled with Tab, muted
+  uint32_t fastForwardSpeed;     // Emulated frames per host frame then
+
+  uint8_t memory[MAX_MEMORY_SIZE]; // Room for XO-CHIP's 64kb
+  uint32_t memorySize;          // Addressable part, MEMORY_SIZE by default
   Interpreter interpreter;      // System Interpreter
-  Screen screen;                // Display and rendering
-  Sound sound;                  // Beeping sound
+  Screen screen;                // Framebuffer
+  Input keypad;                 // Keys and host requests
+
+  // Host backends, null when running headless
+  VideoBackend *video;
+  AudioBackend *audio;
+  InputBackend *input;
+
+  std::unique_ptr<Jit> jit;     // Recompiler, null when interpreting
+
+  // Quick save slot (F5 / F9) and the file it is mirrored to
+  std::unique_ptr<MachineState> quickSave;
+  std::string stateFile;
+
+  Rewind rewind;                // Frame history, filled by Run()
+
+  // Counters, only allocated in profiling builds (F8 or exit dumps them)
+  std::unique_ptr<Profile> profile;
+  std::string profileFile;
+
+  std::unique_ptr<Telemetry> telemetry; // Latency tracking, null when off
 
   CHIP8();                      // Constructor
-  
-  void Run();                   // Program loop
-  bool ReadRom(const char* filename);
+
+  void AttachBackends(VideoBackend *video, AudioBackend *audio,
+                      InputBackend *input);
+
+  // Switches between the interpreter and the JIT, false if unsupported
+  bool UseJit(bool enable);
+
+  void RunCycles(uint32_t cycles);
+  void RunFrame();              // One frame of instructions and a timer tick
+  void Run();                   // Program loop (real time or turbo)
+  void Run(FrameClock &clock);  // The same, paced by `clock`
+  void RefreshHost();           // Sound and present
+  void PollInput();             // Host events, key changes and hotkeys
+  void WaitForNextFrame(const FrameClock &clock); // Wakes early for events
+  void RunFrames(uint32_t frames); // Headless, as fast as possible
+
+  // Idle with both timers stopped and no key event queued: nothing but
+  // host input can change the machine
+  bool WaitingForInput() const;
+  bool ReadRom(const char* filename); // Larger than 4kb switches to 64kb
+
+  // MEMORY_SIZE or MAX_MEMORY_SIZE; addresses wrap at the size
+  bool SetMemorySize(uint32_t size);
+
+  // Variant behavior for the interpreter and the JIT
+  void SetQuirks(QuirkProfile profile);
+
+  // Full machine snapshots
+  void CaptureState(MachineState &state) const;
+  void RestoreState(const MachineState &state);
+  void HandleHotkeys();
+  bool DumpProfile() const;     // Writes profile to profileFile
 };
 
 #endif // CHIP8_HPP
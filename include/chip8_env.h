@@ -0,0 +1,62 @@
+#ifndef CHIP8_ENV_H
+#define CHIP8_ENV_H
+
+/* C interface to VecEnv, for loading the emulator from Python (ctypes,
+ * cffi) or any other language with a C FFI. Built as libchip8env.so by
+ * `make env`. No function keeps pointers it was given or lets a C++
+ * exception through: those that can fail return 0 on success and -1 on an
+ * error (a bad index, or an exception inside), pointers NULL instead. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct chip8_env chip8_env;
+
+/* Words per observation: rows of 64 bit words, most significant bit on
+ * the left. 32 rows of one word (64x32); SUPER-CHIP hires frames are 64
+ * rows of two words (128x64). */
+#define CHIP8_ENV_OBSERVATION_WORDS 32
+#define CHIP8_ENV_HIRES_OBSERVATION_WORDS 128
+
+/* `count` environments running `rom`, stepped on `threads` threads (0: one
+ * per hardware thread). NULL if the ROM cannot be loaded. */
+chip8_env *chip8_env_create(const char *rom, uint32_t count,
+                            uint32_t threads);
+void chip8_env_destroy(chip8_env *env);
+
+uint32_t chip8_env_size(const chip8_env *env);
+void chip8_env_set_instructions_per_frame(chip8_env *env, uint32_t ipf);
+
+/* Environment i seeds its random numbers with seed + i */
+int chip8_env_reset(chip8_env *env, uint64_t seed);
+int chip8_env_reset_one(chip8_env *env, uint32_t index, uint64_t seed);
+
+/* One key mask per environment (bit n: key n down), held for `frames` */
+int chip8_env_step(chip8_env *env, const uint16_t *actions,
+                   uint32_t frames);
+
+/* Framebuffer of one environment, valid until the next step or reset:
+ * OBSERVATION_WORDS, or HIRES_OBSERVATION_WORDS when chip8_env_hires */
+const uint64_t *chip8_env_observe(const chip8_env *env, uint32_t index);
+
+/* Copies every framebuffer into `out` at 64x32, OBSERVATION_WORDS per
+ * environment; hires frames are halved (a pixel is set if any of its 2x2
+ * block is) */
+int chip8_env_observe_all(const chip8_env *env, uint64_t *out);
+
+/* The same at 128x64, HIRES_OBSERVATION_WORDS per environment, for ROMs
+ * that switch to hires; lores frames are doubled */
+int chip8_env_observe_all_hires(const chip8_env *env, uint64_t *out);
+
+/* 1 when the environment shows SUPER-CHIP's 128x64 layout, else 0 */
+int chip8_env_hires(const chip8_env *env, uint32_t index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CHIP8_ENV_H */
@@ -0,0 +1,101 @@
+#ifndef ENSEMBLE_HPP
+#define ENSEMBLE_HPP
+
+#include "ensemble_kernels.hpp"
+#include "rng.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Many copies of one ROM advanced together, for searches and training
+// loops that only differ in their inputs. Registers are stored as arrays
+// across instances; each step picks the pc most instances share and runs
+// that instruction for all of them at once, through AVX2 kernels for the
+// register and branch ops. Everything else, and any instance that drifted
+// away from the group, runs through a scalar copy of the Interpreter's
+// semantics, so every instance ends each frame exactly where a CHIP8
+// would. Only classic CHIP-8 programs are supported: no SUPER-CHIP or
+// XO-CHIP instructions, 64x32 and 4kb.
+class Ensemble {
+public:
+  static constexpr uint16_t MEMORY_SIZE = 0x1000;
+  // Distance between instance memories; the extra cache line keeps the
+  // same address of every instance out of a single cache set
+  static constexpr size_t MEMORY_STRIDE = MEMORY_SIZE + 64;
+
+  uint32_t instructionsPerFrame;
+  uint64_t frameCount;
+
+  // Instance-instructions run in lockstep groups and one by one
+  uint64_t lockstepInstructions;
+  uint64_t scalarInstructions;
+
+  // Idle loops are skipped like Interpreter::skipIdle does; results are
+  // the same either way
+  bool skipIdle;
+  uint64_t idleInstructions; // Instance-instructions skipped so far
+
+  explicit Ensemble(uint32_t instances);
+
+  uint32_t Size() const { return instances; }
+  const char *KernelName() const { return kernels->name; }
+
+  // AVX2 kernels when the CPU has them (the default), else scalar loops;
+  // false if vector kernels were asked for and are unavailable
+  bool UseVectorKernels(bool enable);
+
+  // Same ROM in every instance, false if it does not fit
+  bool LoadRom(const uint8_t *data, size_t size);
+  bool ReadRom(const char *filename);
+
+  void Seed(uint32_t instance, uint64_t seed);
+  void SetKeys(uint32_t instance, uint16_t keys); // Bit n: key n down
+
+  void RunFrame();
+  void RunFrames(uint32_t frames);
+
+  // Per instance state
+  uint8_t GetV(uint32_t instance, uint8_t x) const { return V[x][instance]; }
+  uint16_t GetPC(uint32_t instance) const { return pc[instance]; }
+  uint16_t GetI(uint32_t instance) const { return I[instance]; }
+  uint8_t GetDelayTimer(uint32_t instance) const { return delayTimer[instance]; }
+  const uint64_t *Framebuffer(uint32_t instance) const {
+    return &screen[instance * 32];
+  }
+  const uint8_t *Memory(uint32_t instance) const {
+    return &memory[instance * MEMORY_STRIDE];
+  }
+
+private:
+  uint32_t instances;
+  size_t lanes;           // instances rounded up to LaneArrays::LANE_BLOCK
+  const LaneKernels *kernels;
+
+  // Lockstep registers, one array per register
+  std::vector<uint8_t> V[16];
+  std::vector<uint16_t> pc, I;
+  std::vector<uint32_t> remaining;
+  std::vector<uint8_t> eligible;
+  std::vector<uint8_t> mask;
+
+  // Everything else, one slice per instance
+  std::vector<uint8_t> delayTimer, soundTimer, sp;
+  std::vector<uint16_t> stack;    // 16 per instance
+  std::vector<uint16_t> keys;
+  std::vector<Rng> rng;
+  std::vector<uint64_t> screen;   // 32 rows per instance
+  std::vector<uint8_t> memory;    // MEMORY_STRIDE per instance
+
+  // Loaded program, shared by instances that did not write over it
+  uint8_t image[MEMORY_SIZE];
+  uint16_t imageEnd;
+
+  LaneArrays Arrays();
+  uint16_t PickLeader() const;
+  void ExecuteLane(uint32_t lane, const DecodedInstruction &ins);
+  void RunLaneAlone(uint32_t lane);
+  void SkipIdle(uint32_t lane, uint16_t at, const DecodedInstruction &ins);
+  void WriteMemory(uint32_t lane, uint16_t address, uint8_t value);
+};
+
+#endif // ENSEMBLE_HPP
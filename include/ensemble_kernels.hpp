@@ -0,0 +1,54 @@
+#ifndef ENSEMBLE_KERNELS_HPP
+#define ENSEMBLE_KERNELS_HPP
+
+#include "interpreter.hpp"
+#include <cstddef>
+#include <cstdint>
+
+// Structure-of-arrays view of the lockstep registers of an Ensemble.
+// Arrays hold `count` lanes, a multiple of LANE_BLOCK; padding lanes are
+// never eligible and have nothing remaining.
+struct LaneArrays {
+  static constexpr size_t LANE_BLOCK = 32; // Bytes in an AVX2 register
+
+  size_t count;
+  uint8_t *V[16];
+  uint16_t *pc;
+  uint16_t *I;
+  uint32_t *remaining; // Instructions left in the current frame
+  uint8_t *eligible;   // 0xFF when the lane may join a lockstep group
+};
+
+// One implementation of the lockstep kernels per instruction set
+struct LaneKernels {
+  const char *name;
+
+  // mask[i] = 0xFF for eligible lanes at `leader` with instructions left.
+  // Returns how many; `pending` gets the number of lanes with any left.
+  size_t (*BuildMask)(const LaneArrays &lanes, uint16_t leader,
+                      uint8_t *mask, size_t *pending);
+
+  // Runs `ins` (IsLockstepOp) on the masked lanes, advancing their pc and
+  // taking one instruction off their remaining count
+  void (*Step)(LaneArrays &lanes, const DecodedInstruction &ins,
+               const uint8_t *mask);
+};
+
+// Register and control flow ops with a vector kernel
+inline bool IsLockstepOp(uint8_t op) {
+  switch (op) {
+    case OP_NOP: case OP_JP: case OP_SE_BYTE: case OP_SNE_BYTE:
+    case OP_SE_REG: case OP_SNE_REG: case OP_LD_BYTE: case OP_ADD_BYTE:
+    case OP_LD_REG: case OP_OR: case OP_AND: case OP_XOR: case OP_ADD_REG:
+    case OP_SUB: case OP_SHR: case OP_SUBN: case OP_SHL: case OP_LD_I:
+      return true;
+  }
+  return false;
+}
+
+extern const LaneKernels SCALAR_LANE_KERNELS;
+
+// Null when the build or the CPU lacks AVX2
+const LaneKernels *Avx2LaneKernels();
+
+#endif // ENSEMBLE_KERNELS_HPP
@@ -0,0 +1,45 @@
+#ifndef FRAME_CLOCK_HPP
+#define FRAME_CLOCK_HPP
+
+#include <chrono>
+#include <cstdint>
+
+// Paces emulated 60 Hz frames against the monotonic clock. Frame n is due
+// at start + n / 60 s, computed from the frame count rather than by adding
+// intervals, so the pace never drifts; frames missed while the host was
+// busy are reported together so the emulation catches up. Now() and
+// SleepUntil() can be overridden to run on simulated time.
+class FrameClock {
+public:
+  typedef std::chrono::steady_clock Clock;
+
+  static constexpr uint32_t FRAME_RATE = 60;
+  // Longest catch-up burst; a longer stall (suspend, debugger) is skipped
+  static constexpr uint32_t MAX_CATCH_UP = 6;
+
+  FrameClock();
+  virtual ~FrameClock() = default;
+
+  virtual Clock::time_point Now() const { return Clock::now(); }
+  virtual void SleepUntil(Clock::time_point deadline) const;
+
+  void Reset();
+
+  // Frames whose deadline passed since the last call
+  uint32_t FramesDue();
+
+  Clock::time_point NextDeadline() const;
+  void SleepUntilNextFrame() const;
+
+  // Whole milliseconds left until the next deadline, 0 once it is near
+  uint32_t MillisUntilNextFrame() const;
+
+  // Seconds since Reset()
+  double Elapsed() const;
+
+private:
+  Clock::time_point start;
+  uint64_t frames;  // Frames reported so far
+};
+
+#endif // FRAME_CLOCK_HPP
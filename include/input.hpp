@@ -1,20 +1,76 @@
 #ifndef INPUT_HPP
 #define INPUT_HPP
 
+#include "spsc_queue.hpp"
 #include <cstdint>
 
+// Emulator actions bound to host keys
+enum class Hotkey : uint8_t {
+  SaveState,
+  LoadState,
+  DumpProfile,
+  FastForward,
+};
+
+// Key change stamped with the emulated cycle it takes effect at
+struct KeyEvent {
+  uint64_t cycle;
+  uint8_t key;
+  bool pressed;
+  uint64_t hostTime;  // Telemetry::NowNanos() of the host event, 0 if none
+};
+
+// CHIP-8 hexadecimal keypad and host requests of one machine. Key changes
+// arrive through a lock-free queue, so a frontend, a script or another
+// thread can feed them while the machine runs; the machine applies each
+// one right before executing the cycle it is stamped with.
 class Input {
 public:
-  static bool quitRequested;
-  static void HandleInput();
-  static bool IsKeyDown(uint8_t key);
+  static constexpr size_t EVENT_QUEUE_SIZE = 256;
+  static constexpr uint64_t NOW = 0; // Stamp applied at the next cycle
+
+  bool quitRequested;
+  bool rewindHeld;    // Steps back one frame per frame while set
+
+  Input();
+
+  bool IsKeyDown(uint8_t key) const;
+  void SetKeyState(uint8_t key, bool pressed);  // Immediate, same thread
+
+  // Producer side (one thread at a time). Stamps should not decrease;
+  // an event already in the past applies at the next cycle. False if the
+  // queue is full.
+  bool PostKeyEvent(uint64_t cycle, uint8_t key, bool pressed,
+                    uint64_t hostTime = 0);
+
+  // For producers on the consumer's thread (the SDL frontend): posts for
+  // the next cycle, or when the queue is full applies the queued events
+  // and this one at once, so no key-up is lost and no key sticks down
+  void PostOrApplyKeyEvent(uint8_t key, bool pressed, uint64_t hostTime = 0);
+
+  // Consumer side, called by the machine between instructions
+  void ApplyEventsUntil(uint64_t cycle);   // Events stamped <= cycle
+  uint64_t NextEventCycle() const;         // UINT64_MAX when none
+
+  // Host time of the last press of `key` not yet read by the program,
+  // 0 if none; cleared by the call (latency telemetry)
+  uint64_t TakePressTime(uint8_t key);
+
+  // Hotkeys pressed since they were last taken
+  void PressHotkey(Hotkey hotkey);
+  bool TakeHotkey(Hotkey hotkey);
 
 #ifdef UNIT_TEST
-  static bool *GetKeyStateForTest() { return keyState; }
+  bool *GetKeyStateForTest() { return keyState; }
 #endif
 
 private:
-  static bool keyState[16];
+  bool keyState[16];
+  uint32_t pendingHotkeys; // One bit per Hotkey
+  uint64_t pressTime[16];
+  SpscQueue<KeyEvent, EVENT_QUEUE_SIZE> events;
+
+  void ApplyEvent(const KeyEvent &event);
 };
 
 #endif // INPUT_HPP
@@ -1,15 +1,48 @@
 #ifndef Interpreter_HPP
 #define Interpreter_HPP
 
+#include "quirks.hpp"
+#include "rng.hpp"
 #include <cstdint>
-#include <random>
 
 class CHIP8;
+class Interpreter;
+
+// Instruction handlers, in dispatch table order. DECODE marks a cache
+// entry that still has to be decoded.
+#define CHIP8_OPS(X) \
+  X(DECODE) X(NOP) X(CLS) X(RET) X(JP) X(CALL) X(SE_BYTE) X(SNE_BYTE) \
+  X(SE_REG) X(LD_BYTE) X(ADD_BYTE) X(LD_REG) X(OR) X(AND) X(XOR) \
+  X(ADD_REG) X(SUB) X(SHR) X(SUBN) X(SHL) X(SNE_REG) X(LD_I) X(JP_V0) \
+  X(RND) X(DRW) X(SKP) X(SKNP) X(LD_VX_DT) X(LD_VX_K) X(LD_DT_VX) \
+  X(LD_ST_VX) X(ADD_I_VX) X(LD_F_VX) X(LD_B_VX) X(LD_I_VX) X(LD_VX_I) \
+  X(SCD) X(SCU) X(SCR) X(SCL) X(EXIT) X(LOW) X(HIGH) X(LD_HF_VX) \
+  X(SAVE_FLAGS) X(LOAD_FLAGS) X(SAVE_RANGE) X(LOAD_RANGE) X(LD_I_LONG) \
+  X(PLANE) X(AUDIO) X(PITCH)
+
+enum Op : uint8_t {
+#define CHIP8_OP_ENUM(name) OP_##name,
+  CHIP8_OPS(CHIP8_OP_ENUM)
+#undef CHIP8_OP_ENUM
+  OP_COUNT
+};
+
+// Instruction with its operands already extracted from the opcode
+struct DecodedInstruction {
+  uint16_t nnn;       // Address / 12 bit constant
+  uint8_t x, y;       // Register indexes
+  uint8_t n, nn;      // 4 and 8 bit constants
+  uint8_t op;         // Handler
+};
 
 class Interpreter {
 private:
   uint32_t lastTimerUpdate;
 public:
+  // Program area covered by the decoded instruction cache
+  static constexpr uint16_t CACHE_START = 0x200;
+  static constexpr uint16_t CACHE_END = 0x1000;
+
   uint8_t V[16];      // General purpose registers
   uint16_t I;         // Index register
   
@@ -21,21 +54,62 @@ public:
   uint16_t stack[16]; // Stack
   uint8_t sp;         // Stack pointer
 
+  uint8_t flags[16];  // SUPER-CHIP user flags (FX75 / FX85)
+  uint8_t audioPattern[16]; // XO-CHIP sample bits (F002)
+  uint8_t pitch;      // XO-CHIP playback rate (FX3A)
+
   CHIP8* chip8;       // CHIP-8 System
  
-  std::random_device rd;
-  std::mt19937 gen;
+  Rng rng;            // CXNN source, seeded with 0 unless told otherwise
+
+  // Variant behavior, CosmacVip by default. Set it through
+  // CHIP8::SetQuirks() so the JIT follows.
+  QuirkProfile quirks;
+
+  // Idle loops (FX0A waiting, a jump to itself, FX07 / 3X00 / 1NNN polling
+  // the delay timer) repeat the same state until the next timer tick or key
+  // event, so their remaining cycles are spent without running them.
+  bool skipIdle;        // On by default; results are the same either way
+  bool idle;            // The last run ended in such a loop
+  uint64_t idleCycles;  // Cycles skipped so far
 
   Interpreter(CHIP8* chip8);  // Constructor
 
   void UpdateTimer();
 
+  // With the opcode set of `profile`; tools listing any program take the
+  // widest, XO-CHIP's
+  static DecodedInstruction Decode(uint16_t opcode,
+                                   QuirkProfile profile = QuirkProfile::XoChip);
   void DecodeAndExecute(uint16_t opcode);
   uint8_t FetchByte();
   void RunCycle();
+  void RunCycles(uint32_t cycles);
+
+  // Drops cached decodes overlapping [address, address + length).
+  // Anything writing CHIP8::memory outside of the interpreter must call it.
+  void InvalidateCache(uint16_t address, uint16_t length);
+
+private:
+  // Decoded instructions indexed by pc - CACHE_START
+  DecodedInstruction cache[CACHE_END - CACHE_START];
+
+  // Decode() against the profile's own op table
+  template <class Quirks>
+  static DecodedInstruction Decode(uint16_t opcode);
+
+  // Dispatch loop, one instantiation per quirk profile: runs `single` if
+  // given, then `cycles` instructions
+  template <class Quirks>
+  void Execute(uint32_t cycles, const DecodedInstruction *single);
+
+  // Execute() of the current profile
+  void Dispatch(uint32_t cycles, const DecodedInstruction *single);
 
-  void ExecuteLogicArithmetic(uint16_t opcode);
-  void ExecuteFxInstruction(uint8_t x, uint8_t mode);
+  // Copies to and from memory, wrapping at the addressable size;
+  // stores invalidate what they overwrite
+  void WriteMemory(uint16_t address, const uint8_t *data, uint16_t length);
+  void ReadMemory(uint16_t address, uint8_t *data, uint16_t length) const;
 };
 
 #endif // Interpreter_HPP
@@ -0,0 +1,78 @@
+#ifndef JIT_HPP
+#define JIT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(__x86_64__) && defined(__unix__)
+#define CHIP8_JIT_X86_64 1
+#endif
+
+class CHIP8;
+
+// Dynamic recompiler for CHIP-8 code. Runs of register and index
+// instructions (6XNN, 7XNN, 8XY*, ANNN, FX1E) are translated to x86-64
+// together with the jump (1NNN) or register skip (3XNN, 4XNN, 5XY0, 9XY0)
+// ending them, and cached by start address. Each block returns the pc it
+// leaves at, so blocks follow one another without the Interpreter; runs of
+// other instructions are handed to Interpreter::RunCycles, which also
+// skips the idle loops starting at a jump to itself, FX0A or FX07.
+class Jit {
+public:
+  static constexpr size_t ARENA_SIZE = 1 << 20; // Bytes of native code
+  static constexpr uint16_t MAX_BLOCK = 64;     // Instructions per block
+  static constexpr uint16_t MAX_RUN = 256;      // Per interpreter hand-off
+
+  static bool IsSupported();
+
+  Jit(CHIP8 *chip8);
+  ~Jit();
+
+  // Executes exactly `cycles` instructions from the current pc
+  void RunCycles(uint32_t cycles);
+
+  // Drops blocks overlapping [address, address + length); writes outside
+  // of all code seen, like most data stores, return right away
+  void Invalidate(uint16_t address, uint16_t length) {
+    if (address < coveredEnd && address + length > coveredStart) {
+      Drop(address, length);
+    }
+  }
+
+  // Number of blocks compiled since creation (for measurements)
+  uint32_t compiledBlocks;
+
+private:
+  // Returns the pc after the block
+  typedef uint32_t (*BlockFn)(uint8_t *V, uint16_t *I);
+
+  // Loops Interpreter::skipIdle may spin in, checked before a hand-off
+  enum class IdleLoop : uint8_t { None, Jump, Key, Timer };
+
+  struct Block {
+    BlockFn code;       // Null when the block starts with an instruction
+                        // the interpreter has to run
+    uint16_t count;     // Instructions covered by code, else handed to
+                        // the interpreter at once
+    IdleLoop idle;      // Without code: the idle loop starting here
+    bool valid;
+  };
+
+  CHIP8 *chip8;
+  Block blocks[0x1000];        // Indexed by start address
+  uint16_t covered[0x1000];    // Number of valid blocks reading each byte
+  int coveredStart, coveredEnd; // Bounds of covered bytes since a flush
+  std::vector<uint16_t> live;  // Start addresses of valid blocks
+
+  uint8_t *arena;
+  size_t arenaUsed;
+
+  Block &Compile(uint16_t start);
+  void Drop(uint16_t address, uint16_t length);
+  uint32_t HandOff(const Block &block, uint32_t cycles) const;
+  static IdleLoop IdleLoopAt(const uint8_t *memory, uint16_t at);
+  void Flush();
+};
+
+#endif // JIT_HPP
@@ -0,0 +1,50 @@
+#ifndef PROFILE_HPP
+#define PROFILE_HPP
+
+#include "interpreter.hpp"
+#include <cstdint>
+#include <ostream>
+
+// Instrumentation of the interpreter loop, built with -DCHIP8_PROFILE
+// (make PROFILE=1). Without it every counter update is discarded at
+// compile time and the loop is exactly the uninstrumented one.
+#ifdef CHIP8_PROFILE
+constexpr bool PROFILING = true;
+#else
+constexpr bool PROFILING = false;
+#endif
+
+// Execution counters of one machine. Instructions run by JIT blocks are
+// not seen, profile with the interpreter.
+struct Profile {
+  uint64_t opCounts[OP_COUNT];   // Dispatches per handler, DECODE counting
+                                 // decode cache misses
+  uint64_t pcCounts[0x10000];    // Instructions fetched per address
+  uint16_t pcFunction[0x10000];  // Subroutine each address last ran in
+  uint64_t draws;                // DXYN executions
+  uint64_t memoryWrites;         // Bytes stored by FX33, FX55 and 5XY2
+
+  Profile();
+
+  void Reset();
+
+  // Subroutine tracking, entries match the CHIP-8 stack
+  void Call(uint16_t target);
+  void Return();
+  uint16_t CurrentFunction() const { return callStack[depth]; }
+
+  // Counters as JSON, hottest addresses first
+  void WriteJson(std::ostream &out, const uint8_t *memory) const;
+
+  // "sub_FUNCTION;ADDRESS:OP count" lines for flamegraph.pl and the like
+  void WriteFolded(std::ostream &out, const uint8_t *memory) const;
+
+  // JSON when the name ends in .json, folded stacks otherwise
+  bool WriteFile(const char *filename, const uint8_t *memory) const;
+
+private:
+  uint16_t callStack[17];        // [0] is the program entry
+  uint8_t depth;
+};
+
+#endif // PROFILE_HPP
@@ -0,0 +1,61 @@
+#ifndef QUIRKS_HPP
+#define QUIRKS_HPP
+
+#include <cstdint>
+
+// Behaviors the CHIP-8 variants disagree on. Each profile is a type with
+// compile-time flags; the interpreter's dispatch loop is instantiated once
+// per profile, so the flags cost no branch per instruction.
+enum class QuirkProfile : uint8_t {
+  CosmacVip,  // The original interpreter, the default
+  SuperChip,  // SUPER-CHIP 1.1 on the HP 48
+  XoChip,     // Octo's XO-CHIP
+};
+
+struct CosmacVipQuirks {
+  static constexpr bool VF_RESET = true;       // 8XY1/2/3 clear VF
+  static constexpr bool SHIFT_VY = true;       // 8XY6/8XYE shift Vy, not Vx
+  static constexpr bool INCREMENT_I = true;    // FX55/FX65 advance I
+  static constexpr bool JUMP_VX = false;       // BXNN adds Vx, not V0
+  static constexpr bool WRAP_SPRITES = false;  // Sprites wrap, not clip
+  static constexpr bool LONG_SKIP = false;     // Skips step over F000 NNNN
+  // Opcodes beyond the original set; without them they run as before,
+  // 5XY2/5XY3 as SE Vx, Vy and the rest (DXY0 included) as no-ops
+  static constexpr bool SCHIP_OPS = false;  // 00CN 00FB-00FF DXY0 FX30 FX75 FX85
+  static constexpr bool XO_OPS = false;     // 00DN 5XY2 5XY3 F000 F002 FN01 FX3A
+};
+
+struct SuperChipQuirks {
+  static constexpr bool VF_RESET = false;
+  static constexpr bool SHIFT_VY = false;
+  static constexpr bool INCREMENT_I = false;
+  static constexpr bool JUMP_VX = true;
+  static constexpr bool WRAP_SPRITES = false;
+  static constexpr bool LONG_SKIP = false;
+  static constexpr bool SCHIP_OPS = true;
+  static constexpr bool XO_OPS = false;
+};
+
+struct XoChipQuirks {
+  static constexpr bool VF_RESET = false;
+  static constexpr bool SHIFT_VY = true;
+  static constexpr bool INCREMENT_I = true;
+  static constexpr bool JUMP_VX = false;
+  static constexpr bool WRAP_SPRITES = true;
+  static constexpr bool LONG_SKIP = true;
+  static constexpr bool SCHIP_OPS = true;
+  static constexpr bool XO_OPS = true;
+};
+
+// The same flags as values, for code outside the hot loop (the JIT)
+struct QuirkFlags {
+  bool vfReset, shiftVy, incrementI, jumpVx, wrapSprites, longSkip;
+};
+
+QuirkFlags GetQuirkFlags(QuirkProfile profile);
+
+// "vip", "schip" or "xochip"; Parse is false for an unknown name
+const char *QuirkProfileName(QuirkProfile profile);
+bool ParseQuirkProfile(const char *name, QuirkProfile &profile);
+
+#endif // QUIRKS_HPP
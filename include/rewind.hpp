@@ -0,0 +1,59 @@
+#ifndef REWIND_HPP
+#define REWIND_HPP
+
+#include "save_state.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class CHIP8;
+
+// Frame history for rewinding. Every captured frame is stored as a run
+// length encoded XOR against the keyframe of its segment; segments form a
+// ring, so the oldest segment is dropped whole once the history is full.
+// A segment ends after KEYFRAME_INTERVAL frames, when the memory size
+// changes, or earlier when a delta grows past 1/MAX_DELTA_DIVISOR of the
+// keyframe. Keyframes and deltas only cover the addressable memory, and
+// buffers are reused, capturing does not allocate after the first pass
+// through the ring.
+class Rewind {
+public:
+  static constexpr uint32_t KEYFRAME_INTERVAL = 120; // Frames per segment
+  static constexpr uint32_t SEGMENTS = 150;          // 5 minutes at 60 Hz
+  static constexpr size_t MAX_DELTA_DIVISOR = 8;
+
+  Rewind();
+
+  // Appends the current machine state as the newest frame
+  void Capture(const CHIP8 &chip8);
+
+  // Drops the newest frame and restores the one before it, false when
+  // there is no older frame left
+  bool StepBack(CHIP8 &chip8);
+
+  void Clear();
+
+  uint32_t FramesStored() const;
+  size_t BytesUsed() const;
+
+private:
+  struct Segment {
+    std::vector<uint8_t> keyframe;            // First frame, UsedBytes() long
+    std::vector<std::vector<uint8_t>> deltas; // Following frames
+    uint32_t frames;                          // Keyframe included
+  };
+
+  std::vector<Segment> segments; // Ring, allocated on first capture
+  uint32_t newest;               // Segment holding the newest frame
+  uint32_t segmentCount;
+  MachineState scratch;
+
+  void NewSegment(const MachineState &keyframe);
+
+  static void Encode(const std::vector<uint8_t> &keyframe,
+                     const MachineState &state, std::vector<uint8_t> &out);
+  static void Decode(const std::vector<uint8_t> &keyframe,
+                     const std::vector<uint8_t> &in, MachineState &state);
+};
+
+#endif // REWIND_HPP
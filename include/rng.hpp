@@ -0,0 +1,53 @@
+#ifndef RNG_HPP
+#define RNG_HPP
+
+#include <cstdint>
+
+// xoshiro128** (Blackman and Vigna): 16 bytes of state, a few cycles per
+// number and statistically sound for anything a game does with CXNN.
+// Any generator with the same members can stand in through the Rng alias;
+// save states store its raw state words.
+class Xoshiro128 {
+public:
+  static constexpr int STATE_WORDS = 4;
+
+  uint32_t state[STATE_WORDS];
+
+  explicit Xoshiro128(uint64_t seed = 0) { Seed(seed); }
+
+  // Expands the seed with splitmix64, which never yields an all-zero state
+  void Seed(uint64_t seed) {
+    for (int i = 0; i < STATE_WORDS; i += 2) {
+      uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+      z ^= z >> 31;
+      state[i] = static_cast<uint32_t>(z);
+      state[i + 1] = static_cast<uint32_t>(z >> 32);
+    }
+  }
+
+  uint32_t Next() {
+    uint32_t result = Rotl(state[1] * 5, 7) * 9;
+    uint32_t t = state[1] << 9;
+
+    state[2] ^= state[0];
+    state[3] ^= state[1];
+    state[1] ^= state[2];
+    state[0] ^= state[3];
+    state[2] ^= t;
+    state[3] = Rotl(state[3], 11);
+
+    return result;
+  }
+
+  // The top bits are the strongest ones
+  uint8_t NextByte() { return Next() >> 24; }
+
+private:
+  static uint32_t Rotl(uint32_t x, int k) { return (x << k) | (x >> (32 - k)); }
+};
+
+typedef Xoshiro128 Rng;
+
+#endif // RNG_HPP
@@ -0,0 +1,51 @@
+#ifndef SAVE_STATE_HPP
+#define SAVE_STATE_HPP
+
+#include "rng.hpp"
+#include <cstddef>
+#include <cstdint>
+
+// Snapshot of the whole machine. Capturing and restoring one is a handful
+// of fixed-size copies plus the addressable memory; WriteState/ReadState
+// store it in a versioned binary file (host byte order).
+struct MachineState {
+  static constexpr uint32_t MAGIC = 0x53384843;  // "CH8S"
+  static constexpr uint16_t VERSION = 4;
+
+  uint32_t memorySize;     // Addressable part, 4 KB or 64 KB (XO-CHIP)
+
+  // Interpreter
+  uint8_t V[16];
+  uint16_t I;
+  uint8_t delayTimer;
+  uint8_t soundTimer;
+  uint16_t pc;
+  uint16_t stack[16];
+  uint8_t sp;
+  uint32_t rng[Rng::STATE_WORDS];
+  uint8_t flags[16];       // SUPER-CHIP FX75 / FX85 registers
+  uint8_t audioPattern[16];
+  uint8_t pitch;
+
+  // Screen: both planes in the layout of the mode
+  uint64_t framebuffer[2][128];
+  uint8_t hires;
+  uint8_t planeMask;
+
+  // Emulated time
+  uint64_t cycleCount;
+  uint64_t frameCount;
+
+  // Last, so a 4 KB machine's state is the first UsedBytes() bytes; the
+  // rest is left as it was and never read
+  uint8_t memory[0x10000];
+
+  size_t UsedBytes() const {
+    return offsetof(MachineState, memory) + memorySize;
+  }
+};
+
+bool WriteState(const MachineState &state, const char *filename);
+bool ReadState(MachineState &state, const char *filename);
+
+#endif // SAVE_STATE_HPP
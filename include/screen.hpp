@@ -2,38 +2,80 @@
 #define SCREEN_HPP
 
 #include <cstdint>
-#include <SDL2/SDL.h>
 
 class CHIP8;
 
+// Monochrome framebuffer, 64x32 or 128x64 (SUPER-CHIP hires), with two
+// bitplanes for XO-CHIP. Rows are 64 bit words with the leftmost pixel in
+// the most significant bit: one word per row in lores, so buffer[y] is
+// row y, and two in hires, buffer[2 * y] being the left half. Sprites and
+// scrolls are applied a word at a time in both layouts.
 class Screen {
-private:
-  SDL_Window *window;
-  SDL_Renderer *renderer;
 public:
-  static const int SPRITE_WIDTH;
-  static const int X_TILES, Y_TILES;
-  static const int WIN_WIDTH, WIN_HEIGHT;
+  static constexpr int SPRITE_WIDTH = 8;
+  static constexpr int X_TILES = 64, Y_TILES = 32;        // Lores
+  static constexpr int HIRES_X_TILES = 128, HIRES_Y_TILES = 64;
+  static constexpr int PLANES = 2;
+  static constexpr int BUFFER_WORDS = HIRES_X_TILES / 64 * HIRES_Y_TILES;
 
-  CHIP8 *chip8;         // CHIP-8 System
-  bool buffer[0x800];   // Pixel buffer
+  CHIP8 *chip8;               // CHIP-8 System
+  uint64_t buffer[BUFFER_WORDS];  // Pixel rows of plane 1
+  uint64_t buffer2[BUFFER_WORDS]; // Plane 2, only drawn by XO-CHIP programs
+  bool hires;                 // 128x64 layout
+  uint8_t planeMask;          // Planes drawn, cleared and scrolled (FN01)
+  bool dirty;                 // Changed since the last present
 
   Screen(CHIP8 *chip8); // Constructor
-  ~Screen();            // Destructor 
 
-  // Initializing SDL Subsystems
-  void InitSDL();
+  int Width() const { return hires ? HIRES_X_TILES : X_TILES; }
+  int Height() const { return hires ? HIRES_Y_TILES : Y_TILES; }
+  int RowWords() const { return hires ? 2 : 1; }
 
-  // Rendering window
-  void Render();
+  uint64_t *Plane(int plane) { return plane ? buffer2 : buffer; }
+  const uint64_t *Plane(int plane) const { return plane ? buffer2 : buffer; }
 
-  void Clear();         // Clears display
-  
-  // Draws a sprite of certain height,
-  // at coordinates x and y
+  void Clear();         // Clears the selected planes
+
+  // Switches resolution (00FE / 00FF), which clears every plane
+  void SetHires(bool enable);
+
+  bool GetPixel(int x, int y) const {
+    int words = RowWords();
+    uint64_t word = buffer[y * words + x / 64];
+    return (word >> (63 - x % 64)) & 1;
+  }
+
+  // Plane bits of a pixel, 0 to 3
+  int GetColor(int x, int y) const;
+
+  uint64_t Hash() const;  // FNV-1a of the pixel rows, for comparing runs
+
+  // Expands the framebuffer into Width() x Height() 32 bit pixels, `pitch`
+  // bytes per row, each pixel taking palette[GetColor(x, y)]
+  void Render(uint32_t *pixels, int pitch, const uint32_t palette[4]) const;
+
+  // XORs a sprite into any Y_TILES rows buffer, true on collision
+  static bool DrawRows(uint64_t *rows, uint8_t x, uint8_t y,
+                       uint8_t spriteHeight, const uint8_t *sprite);
+
+  // Draws a sprite of certain height, or 16x16 when the height is 0, at
+  // coordinates x and y into every selected plane. Plane 2 takes its
+  // lines from right after plane 1's. What passes the right or bottom
+  // edge is clipped, or drawn on the opposite side with Wrap.
+  template <bool Wrap = false>
   void drawSprite(uint8_t x, uint8_t y, 
                   uint8_t spriteHeight, 
-                  uint8_t *sprite);
+                  const uint8_t *sprite);
+
+  // Bytes drawSprite reads for a height
+  int SpriteBytes(uint8_t spriteHeight) const;
+
+  // SUPER-CHIP / XO-CHIP scrolls of the selected planes, in pixels of the
+  // current resolution
+  void ScrollDown(int lines);
+  void ScrollUp(int lines);
+  void ScrollRight();   // 4 pixels
+  void ScrollLeft();    // 4 pixels
 
 };
 
@@ -0,0 +1,28 @@
+#ifndef SDL_AUDIO_HPP
+#define SDL_AUDIO_HPP
+
+#include "backend.hpp"
+#include "buzzer.hpp"
+#include <SDL2/SDL.h>
+
+// Buzzer synthesized in the SDL audio callback. The device buffer is a few
+// milliseconds long, so a tone change is heard within one buffer.
+class SDLAudio : public AudioBackend {
+ public:
+  static constexpr int SAMPLE_RATE = 48000;
+  static constexpr int BUFFER_SAMPLES = 256;  // ~5 ms
+
+  SDLAudio();
+  ~SDLAudio();
+
+  void SetTone(bool on) override;
+  void SetPattern(const uint8_t pattern[16], uint8_t pitch) override;
+
+ private:
+  static void Callback(void *userdata, Uint8 *stream, int length);
+
+  Buzzer buzzer;
+  SDL_AudioDeviceID device;  // 0 when no device could be opened
+};
+
+#endif // SDL_AUDIO_HPP
@@ -0,0 +1,23 @@
+#ifndef SDL_INPUT_HPP
+#define SDL_INPUT_HPP
+
+#include "backend.hpp"
+
+class Input;
+union SDL_Event;
+
+// Keyboard input through SDL events
+class SDLInput : public InputBackend {
+public:
+  SDLInput(Input &keypad);
+
+  void PollEvents() override;
+  void WaitEvents(int32_t timeoutMs) override;
+
+private:
+  void HandleEvent(const SDL_Event &e);
+
+  Input &keypad;
+};
+
+#endif // SDL_INPUT_HPP
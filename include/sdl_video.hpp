@@ -0,0 +1,34 @@
+#ifndef SDL_VIDEO_HPP
+#define SDL_VIDEO_HPP
+
+#include "backend.hpp"
+#include <SDL2/SDL.h>
+
+// Window that shows the framebuffer through a streaming texture, scaled
+// up by the renderer
+class SDLVideo : public VideoBackend {
+private:
+  SDL_Window *window;
+  SDL_Renderer *renderer;
+  SDL_Texture *texture;   // One texel per CHIP-8 pixel
+  int textureWidth;       // 64 or 128, follows the screen mode
+
+  void CreateTexture(int width, int height);
+public:
+  static const int WIN_WIDTH, WIN_HEIGHT;
+  // ARGB8888, by plane bits: none, plane 1, plane 2, both
+  static const uint32_t ON_COLOR, OFF_COLOR, PLANE2_COLOR, BOTH_COLOR;
+
+  // Initializes SDL and opens the window; with vsync, presenting waits
+  // for the display's vertical blank instead of tearing
+  SDLVideo(bool vsync = false);
+  ~SDLVideo();          // Destructor
+
+  // Uploads the framebuffer and presents it
+  void Present(const Screen &screen) override;
+
+  // Shown in the window title, SDL alone has no text rendering
+  void SetOverlayText(const std::string &text) override;
+};
+
+#endif // SDL_VIDEO_HPP
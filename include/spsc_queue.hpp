@@ -0,0 +1,50 @@
+#ifndef SPSC_QUEUE_HPP
+#define SPSC_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+
+// Bounded lock-free FIFO for exactly one producer thread and one consumer
+// thread. Indices grow forever and are reduced modulo CAPACITY, so a full
+// queue is tail - head == CAPACITY.
+template <typename T, size_t CAPACITY> class SpscQueue {
+  static_assert((CAPACITY & (CAPACITY - 1)) == 0,
+                "CAPACITY must be a power of two");
+
+public:
+  SpscQueue() : head(0), tail(0) {}
+
+  // Producer side, false when the queue is full
+  bool Push(const T &item) {
+    size_t back = tail.load(std::memory_order_relaxed);
+    if (back - head.load(std::memory_order_acquire) == CAPACITY) {
+      return false;
+    }
+    items[back % CAPACITY] = item;
+    tail.store(back + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side: oldest item, null when empty
+  const T *Peek() const {
+    size_t front = head.load(std::memory_order_relaxed);
+    if (front == tail.load(std::memory_order_acquire)) {
+      return nullptr;
+    }
+    return &items[front % CAPACITY];
+  }
+
+  // Consumer side, only after Peek returned an item
+  void Pop() {
+    head.store(head.load(std::memory_order_relaxed) + 1,
+               std::memory_order_release);
+  }
+
+private:
+  // Each index on its own cache line, they are written by different threads
+  alignas(64) std::atomic<size_t> head;
+  alignas(64) std::atomic<size_t> tail;
+  T items[CAPACITY];
+};
+
+#endif // SPSC_QUEUE_HPP
@@ -0,0 +1,85 @@
+#ifndef TELEMETRY_HPP
+#define TELEMETRY_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+class Input;
+
+// Millisecond histogram with fixed 0.1 ms buckets up to one second, so
+// recording never allocates and percentiles are exact to a bucket
+class LatencyHistogram {
+public:
+  static constexpr int BUCKETS = 10000;
+  static constexpr double BUCKET_MS = 0.1;
+
+  LatencyHistogram();
+
+  void Add(double ms);
+  uint64_t Count() const { return total; }
+
+  // Upper edge of the bucket holding the p-th percentile (0 < p <= 100)
+  double Percentile(double p) const;
+
+  // Percentiles and a coarse bar chart
+  void Write(std::ostream &out, const char *title) const;
+
+private:
+  uint32_t counts[BUCKETS + 1]; // Last bucket collects everything slower
+  uint64_t total;
+};
+
+// Host-side timing of the input to display path. A key press is followed
+// through four timestamps: the host event, the first EX9E/EXA1/FX0A that
+// reads that key, the next framebuffer change and the present that shows
+// it. One press is followed at a time, presses arriving meanwhile are not
+// sampled. Frame times are the intervals between host refreshes.
+class Telemetry {
+public:
+  enum Stage : uint8_t { IDLE, WAITING_FOR_CHANGE, WAITING_FOR_PRESENT };
+
+  Stage stage;
+
+  LatencyHistogram inputToRead;     // Host event to instruction reading it
+  LatencyHistogram readToChange;    // Reading instruction to pixels changed
+  LatencyHistogram changeToPresent; // Pixels changed to present returned
+  LatencyHistogram inputToPresent;  // Whole path
+  LatencyHistogram frameTime;
+
+  Telemetry();
+
+  // steady_clock in nanoseconds, the unit of every timestamp here
+  static uint64_t NowNanos();
+
+  // Called by the interpreter when an instruction reads `key`
+  void OnKeyRead(Input &keypad, uint8_t key) {
+    if (stage == IDLE) {
+      StartSample(keypad, key);
+    }
+  }
+
+  // Called by the screen on any draw or clear
+  void OnScreenChange() {
+    if (stage == WAITING_FOR_CHANGE) {
+      changeTime = NowNanos();
+      stage = WAITING_FOR_PRESENT;
+    }
+  }
+
+  void OnPresent();        // After the video backend presented a frame
+  void OnHostRefresh();    // Once per host frame
+
+  // One line for the window title
+  std::string Summary() const;
+
+  void WriteReport(std::ostream &out) const;
+
+private:
+  uint64_t eventTime, readTime, changeTime;
+  uint64_t lastRefresh;
+
+  void StartSample(Input &keypad, uint8_t key);
+};
+
+#endif // TELEMETRY_HPP
@@ -0,0 +1,56 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads, each with its own task deque. A worker runs
+// its newest task first and, once its deque is empty, steals the oldest
+// task of another worker, so long and short jobs even out across cores.
+class ThreadPool {
+public:
+  // 0 uses one thread per hardware thread
+  explicit ThreadPool(unsigned threads = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  // Queues a task. Called from a worker, the task goes to that worker's
+  // own deque, otherwise deques are filled round-robin.
+  void Submit(std::function<void()> task);
+
+  // Blocks until every submitted task has finished
+  void Wait();
+
+  unsigned ThreadCount() const { return workers.size(); }
+
+private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  std::vector<std::unique_ptr<Queue>> queues; // One per worker
+  std::vector<std::thread> workers;
+
+  std::mutex stateMutex;
+  std::condition_variable workAvailable;
+  std::condition_variable allDone;
+  size_t queued;     // Tasks waiting in a deque, guarded by stateMutex
+  size_t unfinished; // Tasks submitted and not yet finished, same
+  bool stopping;
+  std::atomic<size_t> nextQueue;
+
+  void WorkerLoop(unsigned self);
+  bool TakeTask(unsigned self, std::function<void()> &task);
+};
+
+#endif // THREAD_POOL_HPP
@@ -0,0 +1,70 @@
+#ifndef VEC_ENV_HPP
+#define VEC_ENV_HPP
+
+#include "chip8.hpp"
+#include "save_state.hpp"
+#include "thread_pool.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Vector of headless CHIP8 environments for reinforcement learning, in
+// the reset / step / observe shape of Gym's vector environments. Each
+// environment is a full CHIP8; steps are spread over a thread pool.
+// Observations are Screen::buffer itself (plane 1): rows of 64 bit words,
+// the most significant bit being the leftmost pixel, one word per row in
+// lores and two in SUPER-CHIP hires.
+class VecEnv {
+public:
+  static constexpr size_t OBSERVATION_WORDS = Screen::Y_TILES;
+  static constexpr size_t HIRES_OBSERVATION_WORDS = Screen::BUFFER_WORDS;
+
+  uint32_t instructionsPerFrame; // CHIP8::CYCLES_PER_FRAME by default
+
+  // 0 threads: one per hardware thread, 1: steps run on the caller
+  explicit VecEnv(uint32_t count, unsigned threads = 0);
+
+  uint32_t Size() const { return envs.size(); }
+
+  // Loads the ROM every reset starts from, false if it does not fit
+  bool LoadRom(const uint8_t *data, size_t size);
+  bool ReadRom(const char *filename);
+
+  // Every environment back to the loaded ROM with all keys up.
+  // Environment i draws its random numbers from seed + i.
+  void Reset(uint64_t seed);
+  void ResetOne(uint32_t index, uint64_t seed);
+
+  // actions[i] holds environment i's keys (bit n: key n down) for the
+  // next `frames` frames
+  void Step(const uint16_t *actions, uint32_t frames);
+
+  // Framebuffer of one environment, valid until its next step or reset
+  const uint64_t *Observe(uint32_t index) const {
+    return envs[index]->screen.buffer;
+  }
+
+  // Every framebuffer at 64x32, OBSERVATION_WORDS words per environment.
+  // Hires frames are halved, a pixel set if any of its 2x2 block is.
+  void ObserveAll(uint64_t *out) const;
+
+  // Every framebuffer at 128x64, HIRES_OBSERVATION_WORDS words each, for
+  // ROMs that switch to hires; lores frames are doubled
+  void ObserveAllHires(uint64_t *out) const;
+
+  // 128x64 layout (two words per row) rather than 64x32
+  bool Hires(uint32_t index) const { return envs[index]->screen.hires; }
+
+  CHIP8 &Env(uint32_t index) { return *envs[index]; }
+
+private:
+  std::vector<std::unique_ptr<CHIP8>> envs;
+  std::unique_ptr<ThreadPool> pool; // Null when stepping on the caller
+  MachineState initial;             // State right after LoadRom
+
+  void StepRange(const uint16_t *actions, uint32_t frames, size_t begin,
+                 size_t end);
+};
+
+#endif // VEC_ENV_HPP
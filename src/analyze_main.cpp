@@ -0,0 +1,59 @@
+#include "analyzer.hpp"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+static void PrintUsage(const char *program) {
+  std::cout << "Usage: " << program << " [options] rom\n"
+            << "   --dot FILE     Also write the control flow graph to FILE\n"
+            << "                  as Graphviz (dot -Tsvg FILE > cfg.svg)\n";
+}
+
+int main(int argc, char **argv) {
+  const char *rom = nullptr;
+  const char *dotFile = nullptr;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--dot") == 0 && i + 1 < argc) {
+      dotFile = argv[++i];
+    } else if (argv[i][0] == '-') {
+      std::cout << "Unknown option " << argv[i] << "\n";
+      PrintUsage(argv[0]);
+      return 1;
+    } else {
+      rom = argv[i];
+    }
+  }
+
+  if (rom == nullptr) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  std::ifstream file(rom, std::ios::binary);
+  if (!file) {
+    std::cout << "Failed to open ROM " << rom << "\n";
+    return 1;
+  }
+  std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)),
+                             std::istreambuf_iterator<char>());
+
+  RomAnalysis analysis;
+  if (!analysis.Analyze(bytes.data(), bytes.size())) {
+    std::cout << "ROM " << rom << " is empty or larger than 64kb\n";
+    return 1;
+  }
+  analysis.WriteText(std::cout);
+
+  if (dotFile != nullptr) {
+    std::ofstream dot(dotFile);
+    if (!dot) {
+      std::cout << "Failed to write " << dotFile << "\n";
+      return 1;
+    }
+    analysis.WriteDot(dot);
+  }
+  return 0;
+}
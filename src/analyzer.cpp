@@ -0,0 +1,452 @@
+#include "analyzer.hpp"
+#include "interpreter.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+std::string Hex(unsigned value, int digits = 3) {
+  char text[12];
+  snprintf(text, sizeof(text), "0x%0*X", digits, value);
+  return text;
+}
+
+std::string Reg(unsigned index) {
+  char text[4];
+  snprintf(text, sizeof(text), "V%X", index);
+  return text;
+}
+
+bool IsSkip(uint8_t op) {
+  return op == OP_SE_BYTE || op == OP_SNE_BYTE || op == OP_SE_REG ||
+         op == OP_SNE_REG || op == OP_SKP || op == OP_SKNP;
+}
+
+const char *KindName(ByteKind kind) {
+  switch (kind) {
+  case ByteKind::Code:
+    return "code";
+  case ByteKind::Sprite:
+    return "sprite";
+  case ByteKind::Data:
+    return "data";
+  default:
+    return "unreached";
+  }
+}
+
+} // namespace
+
+bool RomAnalysis::InImage(uint32_t address, uint32_t length) const {
+  return address >= ORIGIN && address + length <= ORIGIN + image.size();
+}
+
+uint16_t RomAnalysis::OpcodeAt(uint16_t address) const {
+  if (!InImage(address)) {
+    return 0;
+  }
+  return image[address - ORIGIN] << 8 | image[address - ORIGIN + 1];
+}
+
+ByteKind RomAnalysis::KindAt(uint16_t address) const {
+  return InImage(address, 1) ? kinds[address - ORIGIN] : ByteKind::Unreached;
+}
+
+void RomAnalysis::Mark(uint32_t address, uint32_t length, ByteKind kind) {
+  // Code wins over data, the first data access over later ones
+  for (uint32_t a = address; a < address + length; a++) {
+    if (InImage(a, 1) && kinds[a - ORIGIN] == ByteKind::Unreached) {
+      kinds[a - ORIGIN] = kind;
+    }
+  }
+}
+
+Flow RomAnalysis::FlowAt(uint16_t address) const {
+  DecodedInstruction ins = Interpreter::Decode(OpcodeAt(address));
+  Flow flow = {uint16_t(ins.op == OP_LD_I_LONG ? 4 : 2), 0, false, true};
+
+  switch (ins.op) {
+  case OP_JP:
+    flow.target = ins.nnn;
+    flow.hasTarget = true;
+    flow.next = false;
+    break;
+  case OP_CALL:
+    flow.target = ins.nnn;
+    flow.hasTarget = true;
+    break;
+  case OP_RET:
+  case OP_EXIT:
+  case OP_JP_V0:
+    flow.next = false;
+    break;
+  default:
+    if (IsSkip(ins.op)) {
+      // Skips step over F000 NNNN whole
+      uint16_t skipped = OpcodeAt(address + 2) == 0xF000 ? 4 : 2;
+      flow.target = address + 2 + skipped;
+      flow.hasTarget = true;
+    }
+    break;
+  }
+  return flow;
+}
+
+bool RomAnalysis::Analyze(const uint8_t *rom, size_t size) {
+  if (size == 0 || size > 0x10000 - ORIGIN) {
+    return false;
+  }
+
+  image.assign(rom, rom + size);
+  kinds.assign(size, ByteKind::Unreached);
+  blocks.clear();
+  subroutines.clear();
+  indirectJumps.clear();
+  externalTargets.clear();
+
+  // Every reachable instruction, and the addresses blocks start at
+  std::vector<bool> decoded(size), leader(size);
+  std::vector<uint16_t> work;
+  auto follow = [&](uint32_t target) {
+    if (!InImage(target)) {
+      externalTargets.push_back(target);
+      return;
+    }
+    leader[target - ORIGIN] = true;
+    work.push_back(target);
+  };
+  follow(ORIGIN);
+
+  while (!work.empty()) {
+    uint32_t address = work.back();
+    work.pop_back();
+
+    while (InImage(address) && !decoded[address - ORIGIN]) {
+      decoded[address - ORIGIN] = true;
+      Flow flow = FlowAt(address);
+      if (flow.hasTarget) {
+        follow(flow.target);
+        if (Interpreter::Decode(OpcodeAt(address)).op == OP_CALL) {
+          subroutines.push_back(flow.target);
+        }
+      }
+      if (!flow.next) {
+        break;
+      }
+      // Whatever follows a branch is entered from two places
+      address += flow.length;
+      if (flow.hasTarget) {
+        follow(address);
+        break;
+      }
+      if (!InImage(address)) {
+        externalTargets.push_back(address);
+      }
+    }
+  }
+
+  // Blocks run from each leader to the first branch or the next leader
+  for (uint32_t start = ORIGIN; start < ORIGIN + size; start++) {
+    if (!leader[start - ORIGIN] || !decoded[start - ORIGIN]) {
+      continue;
+    }
+
+    BasicBlock block = {uint16_t(start), 0, {}, 0, false, false, false};
+    uint32_t address = start;
+    while (true) {
+      uint16_t opcode = OpcodeAt(address);
+      uint8_t op = Interpreter::Decode(opcode).op;
+      Flow flow = FlowAt(address);
+      Mark(address, flow.length, ByteKind::Code);
+      uint32_t next = address + flow.length;
+
+      if (op == OP_CALL) {
+        block.call = flow.target;
+        block.successors.push_back(next);
+      } else if (flow.hasTarget) {
+        block.successors.push_back(flow.target);
+        if (flow.next) {
+          block.successors.push_back(next);
+        }
+        block.halts = op == OP_JP && flow.target == address;
+      } else if (op == OP_RET) {
+        block.returns = true;
+      } else if (op == OP_EXIT) {
+        block.halts = true;
+      } else if (op == OP_JP_V0) {
+        block.indirect = true;
+        indirectJumps.push_back(address);
+      } else if (InImage(next) && decoded[next - ORIGIN] &&
+                 !leader[next - ORIGIN]) {
+        address = next;
+        continue;
+      } else if (InImage(next)) {
+        block.successors.push_back(next); // Falls into the next block
+      }
+
+      block.end = next;
+      break;
+    }
+
+    std::sort(block.successors.begin(), block.successors.end());
+    block.successors.erase(
+        std::unique(block.successors.begin(), block.successors.end()),
+        block.successors.end());
+    blocks[block.start] = block;
+  }
+
+  std::sort(subroutines.begin(), subroutines.end());
+  subroutines.erase(std::unique(subroutines.begin(), subroutines.end()),
+                    subroutines.end());
+  std::sort(externalTargets.begin(), externalTargets.end());
+  externalTargets.erase(
+      std::unique(externalTargets.begin(), externalTargets.end()),
+      externalTargets.end());
+
+  // Code is all marked, so data never takes over an instruction
+  for (const auto &entry : blocks) {
+    FindData(entry.second);
+  }
+  return true;
+}
+
+void RomAnalysis::FindData(const BasicBlock &block) {
+  int32_t I = -1; // Unknown at block entry
+
+  for (uint32_t address = block.start; address < block.end;) {
+    uint16_t opcode = OpcodeAt(address);
+    DecodedInstruction ins = Interpreter::Decode(opcode);
+
+    switch (ins.op) {
+    case OP_LD_I:
+      I = ins.nnn;
+      break;
+    case OP_LD_I_LONG:
+      I = OpcodeAt(address + 2);
+      break;
+    case OP_DRW:
+      if (I >= 0) {
+        Mark(I, ins.n == 0 ? 32 : ins.n, ByteKind::Sprite);
+      }
+      break;
+    case OP_LD_B_VX:
+      if (I >= 0) {
+        Mark(I, 3, ByteKind::Data);
+      }
+      break;
+    case OP_AUDIO:
+      if (I >= 0) {
+        Mark(I, 16, ByteKind::Data);
+      }
+      break;
+    case OP_SAVE_RANGE:
+    case OP_LOAD_RANGE:
+      if (I >= 0) {
+        Mark(I, std::abs(ins.x - ins.y) + 1, ByteKind::Data);
+      }
+      break;
+    case OP_LD_I_VX:
+    case OP_LD_VX_I:
+      if (I >= 0) {
+        Mark(I, ins.x + 1, ByteKind::Data);
+      }
+      I = -1; // Advanced or not depending on the quirk profile
+      break;
+    case OP_ADD_I_VX:
+    case OP_LD_F_VX:
+    case OP_LD_HF_VX:
+      I = -1;
+      break;
+    }
+    address += ins.op == OP_LD_I_LONG ? 4 : 2;
+  }
+}
+
+std::string RomAnalysis::Disassemble(uint16_t opcode, uint16_t operand) {
+  DecodedInstruction ins = Interpreter::Decode(opcode);
+  std::string x = Reg(ins.x), y = Reg(ins.y);
+  std::string nn = Hex(ins.nn, 2), nnn = Hex(ins.nnn);
+
+  switch (ins.op) {
+  case OP_CLS: return "CLS";
+  case OP_RET: return "RET";
+  case OP_JP: return "JP " + nnn;
+  case OP_CALL: return "CALL " + nnn;
+  case OP_SE_BYTE: return "SE " + x + ", " + nn;
+  case OP_SNE_BYTE: return "SNE " + x + ", " + nn;
+  case OP_SE_REG: return "SE " + x + ", " + y;
+  case OP_LD_BYTE: return "LD " + x + ", " + nn;
+  case OP_ADD_BYTE: return "ADD " + x + ", " + nn;
+  case OP_LD_REG: return "LD " + x + ", " + y;
+  case OP_OR: return "OR " + x + ", " + y;
+  case OP_AND: return "AND " + x + ", " + y;
+  case OP_XOR: return "XOR " + x + ", " + y;
+  case OP_ADD_REG: return "ADD " + x + ", " + y;
+  case OP_SUB: return "SUB " + x + ", " + y;
+  case OP_SHR: return "SHR " + x + ", " + y;
+  case OP_SUBN: return "SUBN " + x + ", " + y;
+  case OP_SHL: return "SHL " + x + ", " + y;
+  case OP_SNE_REG: return "SNE " + x + ", " + y;
+  case OP_LD_I: return "LD I, " + nnn;
+  case OP_JP_V0: return "JP V0, " + nnn;
+  case OP_RND: return "RND " + x + ", " + nn;
+  case OP_DRW: return "DRW " + x + ", " + y + ", " + std::to_string(ins.n);
+  case OP_SKP: return "SKP " + x;
+  case OP_SKNP: return "SKNP " + x;
+  case OP_LD_VX_DT: return "LD " + x + ", DT";
+  case OP_LD_VX_K: return "LD " + x + ", K";
+  case OP_LD_DT_VX: return "LD DT, " + x;
+  case OP_LD_ST_VX: return "LD ST, " + x;
+  case OP_ADD_I_VX: return "ADD I, " + x;
+  case OP_LD_F_VX: return "LD F, " + x;
+  case OP_LD_B_VX: return "LD B, " + x;
+  case OP_LD_I_VX: return "LD [I], " + x;
+  case OP_LD_VX_I: return "LD " + x + ", [I]";
+  case OP_SCD: return "SCD " + std::to_string(ins.n);
+  case OP_SCU: return "SCU " + std::to_string(ins.n);
+  case OP_SCR: return "SCR";
+  case OP_SCL: return "SCL";
+  case OP_EXIT: return "EXIT";
+  case OP_LOW: return "LOW";
+  case OP_HIGH: return "HIGH";
+  case OP_LD_HF_VX: return "LD HF, " + x;
+  case OP_SAVE_FLAGS: return "LD R, " + x;
+  case OP_LOAD_FLAGS: return "LD " + x + ", R";
+  case OP_SAVE_RANGE: return "SAVE " + x + " - " + y;
+  case OP_LOAD_RANGE: return "LOAD " + x + " - " + y;
+  case OP_LD_I_LONG: return "LD I, " + Hex(operand, 4);
+  case OP_PLANE: return "PLANE " + std::to_string(ins.x);
+  case OP_AUDIO: return "AUDIO";
+  case OP_PITCH: return "PITCH " + x;
+  default:
+    // 0NNN machine code calls are ignored like NOPs, the rest is no opcode
+    return (opcode >> 12) == 0 ? "SYS " + nnn : "DW " + Hex(opcode, 4);
+  }
+}
+
+void RomAnalysis::WriteText(std::ostream &out) const {
+  size_t counts[4] = {};
+  for (ByteKind kind : kinds) {
+    counts[static_cast<int>(kind)]++;
+  }
+
+  out << "; " << image.size() << " bytes at " << Hex(ORIGIN) << ": "
+      << blocks.size() << " blocks, " << subroutines.size()
+      << " subroutines, " << indirectJumps.size() << " indirect jumps\n"
+      << "; " << counts[int(ByteKind::Code)] << " code, "
+      << counts[int(ByteKind::Sprite)] << " sprite, "
+      << counts[int(ByteKind::Data)] << " data, "
+      << counts[int(ByteKind::Unreached)] << " unreached bytes\n";
+  for (uint16_t target : externalTargets) {
+    out << "; edge to " << Hex(target) << " outside the ROM\n";
+  }
+
+  uint32_t end = ORIGIN + image.size();
+  for (uint32_t address = ORIGIN; address < end;) {
+    auto block = blocks.find(address);
+    if (block != blocks.end()) {
+      const BasicBlock &b = block->second;
+      out << "\n";
+      if (std::binary_search(subroutines.begin(), subroutines.end(), b.start)) {
+        out << "sub_" << Hex(b.start) << ":\n";
+      }
+      out << Hex(b.start) << ":";
+      if (!b.successors.empty()) {
+        out << " ->";
+        for (uint16_t successor : b.successors) {
+          out << " " << Hex(successor);
+        }
+      }
+      if (b.call) out << " (calls " << Hex(b.call) << ")";
+      if (b.indirect) out << " (indirect)";
+      if (b.returns) out << " (returns)";
+      if (b.halts) out << " (halts)";
+      out << "\n";
+
+      for (uint32_t a = b.start; a < b.end;) {
+        uint16_t opcode = OpcodeAt(a);
+        uint16_t operand = opcode == 0xF000 ? OpcodeAt(a + 2) : 0;
+        char word[8];
+        snprintf(word, sizeof(word), "%04X", opcode);
+        out << "  " << Hex(a) << "  " << word << "  "
+            << Disassemble(opcode, operand) << "\n";
+        a += opcode == 0xF000 ? 4 : 2;
+      }
+      address = b.end;
+      continue;
+    }
+
+    // A run of bytes of one kind, up to the next block
+    ByteKind kind = kinds[address - ORIGIN];
+    uint32_t runEnd = address + 1;
+    while (runEnd < end && kinds[runEnd - ORIGIN] == kind &&
+           blocks.find(runEnd) == blocks.end()) {
+      runEnd++;
+    }
+
+    out << "\n" << Hex(address) << ": " << KindName(kind) << ", "
+        << runEnd - address << " bytes\n";
+    for (uint32_t a = address; a < runEnd;) {
+      out << "  " << Hex(a) << " ";
+      if (kind == ByteKind::Sprite) {
+        // One sprite line, drawn
+        char bits[9] = {};
+        for (int bit = 0; bit < 8; bit++) {
+          bits[bit] = image[a - ORIGIN] >> (7 - bit) & 1 ? '#' : '.';
+        }
+        char value[4];
+        snprintf(value, sizeof(value), "%02X", image[a - ORIGIN]);
+        out << " " << value << "  " << bits << "\n";
+        a++;
+        continue;
+      }
+      for (int i = 0; i < 8 && a < runEnd; i++, a++) {
+        char value[4];
+        snprintf(value, sizeof(value), "%02X", image[a - ORIGIN]);
+        out << " " << value;
+      }
+      out << "\n";
+    }
+    address = runEnd;
+  }
+}
+
+void RomAnalysis::WriteDot(std::ostream &out) const {
+  out << "digraph rom {\n"
+      << "  node [shape=box, fontname=\"monospace\"];\n";
+
+  for (const auto &entry : blocks) {
+    const BasicBlock &b = entry.second;
+    out << "  \"" << Hex(b.start) << "\" [label=\"" << Hex(b.start)
+        << "\\l";
+    for (uint32_t a = b.start; a < b.end;) {
+      uint16_t opcode = OpcodeAt(a);
+      uint16_t operand = opcode == 0xF000 ? OpcodeAt(a + 2) : 0;
+      out << Disassemble(opcode, operand) << "\\l";
+      a += opcode == 0xF000 ? 4 : 2;
+    }
+    out << "\"";
+    if (std::binary_search(subroutines.begin(), subroutines.end(), b.start)) {
+      out << ", peripheries=2";
+    }
+    if (b.indirect) {
+      out << ", color=red";
+    }
+    out << "];\n";
+
+    for (uint16_t successor : b.successors) {
+      out << "  \"" << Hex(b.start) << "\" -> \"" << Hex(successor)
+          << "\";\n";
+    }
+    if (b.call) {
+      out << "  \"" << Hex(b.start) << "\" -> \"" << Hex(b.call)
+          << "\" [style=dashed];\n";
+    }
+  }
+
+  for (uint16_t target : externalTargets) {
+    out << "  \"" << Hex(target) << "\" [shape=ellipse, style=dotted];\n";
+  }
+  out << "}\n";
+}
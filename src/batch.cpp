@@ -0,0 +1,200 @@
+#include "batch.hpp"
+#include "chip8.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+
+namespace {
+
+// Strips a trailing '#' comment, true if anything is left
+bool StripComment(std::string &line) {
+  size_t comment = line.find('#');
+  if (comment != std::string::npos) {
+    line.erase(comment);
+  }
+  return line.find_first_not_of(" \t\r") != std::string::npos;
+}
+
+std::string JsonString(const std::string &text) {
+  std::string quoted = "\"";
+  for (char ch : text) {
+    if (ch == '"' || ch == '\\') {
+      quoted += '\\';
+    }
+    quoted += ch;
+  }
+  return quoted + "\"";
+}
+
+std::string HexHash(uint64_t hash) {
+  char text[17];
+  snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(hash));
+  return text;
+}
+
+} // namespace
+
+bool ReadManifest(const char *filename, std::vector<BatchJob> &jobs) {
+  std::ifstream file(filename);
+
+  if (!file) {
+    std::cerr << "Error while opening the manifest\n";
+    return false;
+  }
+
+  std::string line;
+  for (int number = 1; std::getline(file, line); number++) {
+    if (!StripComment(line)) {
+      continue;
+    }
+
+    std::istringstream fields(line);
+    BatchJob job;
+    long frames = 0;
+    if (!(fields >> job.rom >> frames) || frames <= 0) {
+      std::cerr << filename << ":" << number << ": expected \"rom frames [script]\"\n";
+      return false;
+    }
+    job.frames = frames;
+    fields >> job.script;
+    jobs.push_back(job);
+  }
+
+  return true;
+}
+
+bool ReadInputScript(const char *filename, uint32_t instructionsPerFrame,
+                     std::vector<KeyEvent> &events) {
+  std::ifstream file(filename);
+
+  if (!file) {
+    std::cerr << "Error while opening the input script\n";
+    return false;
+  }
+
+  std::string line;
+  for (int number = 1; std::getline(file, line); number++) {
+    if (!StripComment(line)) {
+      continue;
+    }
+
+    std::istringstream fields(line);
+    bool exactCycle = fields >> std::ws && fields.peek() == '@';
+    if (exactCycle) {
+      fields.get();
+    }
+    long long time = -1;
+    unsigned key = 16;
+    std::string action;
+    if (!(fields >> time >> std::hex >> key >> action) || time < 0 ||
+        key > 0xF || (action != "down" && action != "up")) {
+      std::cerr << filename << ":" << number << ": expected \"time key down|up\"\n";
+      return false;
+    }
+    uint64_t cycle = exactCycle ? time : time * uint64_t(instructionsPerFrame);
+    events.push_back({cycle, static_cast<uint8_t>(key), action == "down", 0});
+  }
+
+  // The keypad queue wants increasing stamps, equal ones keep their order
+  std::stable_sort(events.begin(), events.end(),
+                   [](const KeyEvent &a, const KeyEvent &b) {
+                     return a.cycle < b.cycle;
+                   });
+  return true;
+}
+
+BatchResult RunBatchJob(const BatchJob &job, const BatchOptions &options) {
+  BatchResult result = {false, "", 0, 0, 0.0};
+  auto start = std::chrono::steady_clock::now();
+
+  std::vector<KeyEvent> events;
+  if (!job.script.empty() &&
+      !ReadInputScript(job.script.c_str(), options.instructionsPerFrame,
+                       events)) {
+    result.error = "bad input script";
+    return result;
+  }
+
+  // Large (cache and JIT tables), so kept off the worker's stack
+  std::unique_ptr<CHIP8> chip8(new CHIP8);
+  chip8->instructionsPerFrame = options.instructionsPerFrame;
+  chip8->SetQuirks(options.quirks);
+  chip8->UseJit(options.useJit);
+  chip8->interpreter.rng.Seed(options.seed);
+
+  if (!chip8->ReadRom(job.rom.c_str())) {
+    result.error = "could not load ROM";
+    return result;
+  }
+
+  // The queue is bounded, so events are fed a frame ahead of their cycle
+  size_t next = 0;
+  for (uint32_t frame = 0; frame < job.frames; frame++) {
+    uint64_t frameEnd = chip8->cycleCount + options.instructionsPerFrame;
+    for (; next < events.size() && events[next].cycle < frameEnd; next++) {
+      const KeyEvent &event = events[next];
+      if (!chip8->keypad.PostKeyEvent(event.cycle, event.key, event.pressed)) {
+        break;
+      }
+    }
+    chip8->RunFrame();
+  }
+
+  result.ok = true;
+  result.cycles = chip8->cycleCount;
+  result.framebufferHash = chip8->screen.Hash();
+  result.wallSeconds = std::chrono::duration<double>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+  return result;
+}
+
+std::vector<BatchResult> RunBatch(const std::vector<BatchJob> &jobs,
+                                  const BatchOptions &options,
+                                  unsigned threads) {
+  std::vector<BatchResult> results(jobs.size());
+  ThreadPool pool(threads);
+
+  for (size_t i = 0; i < jobs.size(); i++) {
+    pool.Submit([&, i] { results[i] = RunBatchJob(jobs[i], options); });
+  }
+  pool.Wait();
+
+  return results;
+}
+
+void WriteCsvReport(std::ostream &out, const std::vector<BatchJob> &jobs,
+                    const std::vector<BatchResult> &results) {
+  out << "rom,frames,script,status,cycles,framebuffer_hash,wall_ms\n";
+  for (size_t i = 0; i < jobs.size(); i++) {
+    const BatchResult &r = results[i];
+    out << jobs[i].rom << "," << jobs[i].frames << "," << jobs[i].script << ","
+        << (r.ok ? "ok" : r.error) << "," << r.cycles << ","
+        << HexHash(r.framebufferHash) << "," << std::fixed
+        << std::setprecision(3) << r.wallSeconds * 1e3 << "\n";
+  }
+}
+
+void WriteJsonReport(std::ostream &out, const std::vector<BatchJob> &jobs,
+                     const std::vector<BatchResult> &results) {
+  out << "[\n";
+  for (size_t i = 0; i < jobs.size(); i++) {
+    const BatchResult &r = results[i];
+    out << "  {\"rom\": " << JsonString(jobs[i].rom)
+        << ", \"frames\": " << jobs[i].frames
+        << ", \"script\": " << JsonString(jobs[i].script)
+        << ", \"status\": " << JsonString(r.ok ? "ok" : r.error)
+        << ", \"cycles\": " << r.cycles
+        << ", \"framebuffer_hash\": \"" << HexHash(r.framebufferHash) << "\""
+        << ", \"wall_ms\": " << std::fixed << std::setprecision(3)
+        << r.wallSeconds * 1e3 << "}" << (i + 1 < jobs.size() ? "," : "")
+        << "\n";
+  }
+  out << "]\n";
+}
@@ -0,0 +1,106 @@
+#include "batch.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+static void PrintUsage(const char *program) {
+  std::cout << "Usage: " << program << " [options] manifest\n"
+            << "   --jit          Run with the x86-64 recompiler\n"
+            << "   --ipf N        Instructions per 60 Hz frame (default "
+            << CHIP8::CYCLES_PER_FRAME << ")\n"
+            << "   --seed N       RND seed (default 0)\n"
+            << "   --quirks NAME  vip (default), schip or xochip behavior\n"
+            << "   --threads N    Worker threads (default: all cores)\n"
+            << "   --report FILE  Write the report to FILE, JSON if it ends\n"
+            << "                  in .json, CSV otherwise (default: stdout)\n";
+}
+
+// Positive integer option value, 0 if invalid
+static unsigned long ParseCount(const char *value) {
+  char *end;
+  unsigned long count = strtoul(value, &end, 10);
+  return (*value != '\0' && *end == '\0') ? count : 0;
+}
+
+static bool EndsWith(const std::string &text, const std::string &suffix) {
+  return text.size() >= suffix.size() &&
+         text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+int main(int argc, char **argv) {
+  const char *manifest = nullptr;
+  std::string report;
+  BatchOptions options;
+  unsigned long threads = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--jit") == 0) {
+      options.useJit = true;
+    } else if (strcmp(argv[i], "--ipf") == 0 && i + 1 < argc) {
+      options.instructionsPerFrame = ParseCount(argv[++i]);
+      if (options.instructionsPerFrame == 0) {
+        std::cerr << "--ipf expects a positive number\n";
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      options.seed = strtoull(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--quirks") == 0 && i + 1 < argc) {
+      if (!ParseQuirkProfile(argv[++i], options.quirks)) {
+        std::cerr << "--quirks expects vip, schip or xochip\n";
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      threads = ParseCount(argv[++i]);
+      if (threads == 0) {
+        std::cerr << "--threads expects a positive number\n";
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--report") == 0 && i + 1 < argc) {
+      report = argv[++i];
+    } else if (argv[i][0] == '-') {
+      std::cerr << "Unknown option " << argv[i] << "\n";
+      PrintUsage(argv[0]);
+      return 1;
+    } else {
+      manifest = argv[i];
+    }
+  }
+
+  if (manifest == nullptr) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  std::vector<BatchJob> jobs;
+  if (!ReadManifest(manifest, jobs)) {
+    return 1;
+  }
+
+  std::vector<BatchResult> results = RunBatch(jobs, options, threads);
+
+  std::ofstream file;
+  if (!report.empty()) {
+    file.open(report);
+    if (!file) {
+      std::cerr << "Error while opening the report file\n";
+      return 1;
+    }
+  }
+  std::ostream &out = report.empty() ? std::cout : file;
+
+  if (EndsWith(report, ".json")) {
+    WriteJsonReport(out, jobs, results);
+  } else {
+    WriteCsvReport(out, jobs, results);
+  }
+
+  // Non-zero when a job could not run, so scripts can tell
+  for (const BatchResult &result : results) {
+    if (!result.ok) {
+      return 2;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,61 @@
+#include "buzzer.hpp"
+#include <cmath>
+
+Buzzer::Buzzer(uint32_t sampleRate)
+    : on(false), pattern(), patternStep(0), sampleRate(sampleRate), phase(0),
+      step(static_cast<uint32_t>((uint64_t(FREQUENCY) << 32) / sampleRate)),
+      gain(0) {}
+
+void Buzzer::SetTone(bool enable) {
+  on.store(enable, std::memory_order_relaxed);
+}
+
+bool Buzzer::ToneOn() const {
+  return on.load(std::memory_order_relaxed);
+}
+
+void Buzzer::SetPattern(const uint8_t bits[16], uint8_t pitch) {
+  for (int half = 0; half < 2; half++) {
+    uint64_t word = 0;
+    for (int i = 0; i < 8; i++) {
+      word = word << 8 | bits[8 * half + i];
+    }
+    pattern[half].store(word, std::memory_order_relaxed);
+  }
+
+  // A period is the 128 bits, so the phase moves rate / 128 periods a second
+  double rate = 4000.0 * std::pow(2.0, (pitch - 64) / 48.0);
+  patternStep.store(static_cast<uint32_t>(std::llround(
+                        rate / 128 * 4294967296.0 / sampleRate)),
+                    std::memory_order_relaxed);
+}
+
+void Buzzer::Fill(int16_t *samples, int count) {
+  int32_t target = ToneOn() ? RAMP_SAMPLES : 0;
+  uint64_t bits[2] = {pattern[0].load(std::memory_order_relaxed),
+                      pattern[1].load(std::memory_order_relaxed)};
+  bool square = (bits[0] | bits[1]) == 0;
+  uint32_t advance =
+      square ? step : patternStep.load(std::memory_order_relaxed);
+
+  for (int i = 0; i < count; i++) {
+    if (gain != target) {
+      gain += gain < target ? 1 : -1;
+    }
+    bool high;
+    if (square) {
+      high = phase < 0x80000000u;
+    } else {
+      uint32_t bit = phase >> 25; // 128 bits per period
+      high = bits[bit >> 6] >> (63 - (bit & 63)) & 1;
+    }
+    int32_t level = high ? AMPLITUDE : -AMPLITUDE;
+    samples[i] = static_cast<int16_t>(level * gain / RAMP_SAMPLES);
+    phase += advance;
+  }
+
+  // Every tone starts on the same edge
+  if (gain == 0) {
+    phase = 0;
+  }
+}
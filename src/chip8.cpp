@@ -1,75 +1,273 @@
 #include "chip8.hpp"
 #include "input.hpp"
-#include <SDL2/SDL_events.h>
+#include "frame_clock.hpp"
+#include <algorithm>
 #include <cstring>
 #include <fstream>
 #include <iostream>
 
+const uint8_t CHIP8::FONT_DATA[16 * FONT_SPRITE_HEIGHT] = {
+    0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
+    0x20, 0x60, 0x20, 0x20, 0x70, // 1
+    0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
+    0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
+    0x90, 0x90, 0xF0, 0x10, 0x10, // 4
+    0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
+    0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
+    0xF0, 0x10, 0x20, 0x40, 0x40, // 7
+    0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
+    0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
+    0xF0, 0x90, 0xF0, 0x90, 0x90, // A
+    0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
+    0xF0, 0x80, 0x80, 0x80, 0xF0, // C
+    0xE0, 0x90, 0x90, 0x90, 0xE0, // D
+    0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
+    0xF0, 0x80, 0xF0, 0x80, 0x80  // F
+};
+
+const uint8_t CHIP8::BIG_FONT_DATA[16 * BIG_FONT_SPRITE_HEIGHT] = {
+    0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, // 0
+    0x18, 0x78, 0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0xFF, 0xFF, // 1
+    0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // 2
+    0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 3
+    0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, // 4
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 5
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 6
+    0xFF, 0xFF, 0x03, 0x03, 0x06, 0x0C, 0x18, 0x18, 0x18, 0x18, // 7
+    0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 8
+    0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 9
+    0x7E, 0xFF, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, // A
+    0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, // B
+    0x3C, 0xFF, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xFF, 0x3C, // C
+    0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC, // D
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // E
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0  // F
+};
+
 CHIP8::CHIP8()
-    : frameStart(0), interpreter(this), screen(this), sound("sound/beep.wav") {
+    : cycleCount(0), frameCount(0), instructionsPerFrame(CYCLES_PER_FRAME),
+      turbo(false), fastForward(false), fastForwardSpeed(FAST_FORWARD_SPEED),
+      memorySize(MEMORY_SIZE), interpreter(this), screen(this), video(nullptr),
+      audio(nullptr), input(nullptr) {
+  memset(memory, 0, sizeof(memory));
+
   // Initializing font data
-  uint8_t fontData[] = {
-      0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
-      0x20, 0x60, 0x20, 0x20, 0x70, // 1
-      0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
-      0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
-      0x90, 0x90, 0xF0, 0x10, 0x10, // 4
-      0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
-      0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
-      0xF0, 0x10, 0x20, 0x40, 0x40, // 7
-      0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
-      0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
-      0xF0, 0x90, 0xF0, 0x90, 0x90, // A
-      0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
-      0xF0, 0x80, 0x80, 0x80, 0xF0, // C
-      0xE0, 0x90, 0x90, 0x90, 0xE0, // D
-      0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
-      0xF0, 0x80, 0xF0, 0x80, 0x80  // F
-  };
-
-  memcpy(&memory[0x50], fontData, sizeof(fontData));
+  memcpy(&memory[FONT_DATA_START], FONT_DATA, sizeof(FONT_DATA));
+  memcpy(&memory[BIG_FONT_DATA_START], BIG_FONT_DATA, sizeof(BIG_FONT_DATA));
+
+  if (PROFILING) {
+    profile.reset(new Profile);
+  }
+}
+
+void CHIP8::AttachBackends(VideoBackend *video, AudioBackend *audio,
+                           InputBackend *input) {
+  this->video = video;
+  this->audio = audio;
+  this->input = input;
+}
+
+bool CHIP8::UseJit(bool enable) {
+  if (!enable) {
+    jit.reset();
+    return true;
+  }
+
+  if (!Jit::IsSupported()) {
+    return false;
+  }
+
+  if (!jit) {
+    jit.reset(new Jit(this));
+  }
+  return true;
+}
+
+void CHIP8::RunCycles(uint32_t cycles) {
+  // Runs up to each stamped key event, so it lands on its exact cycle
+  while (cycles > 0) {
+    keypad.ApplyEventsUntil(cycleCount);
+    uint64_t untilEvent = keypad.NextEventCycle() - cycleCount;
+    uint32_t chunk = untilEvent < cycles ? untilEvent : cycles;
+
+    cycleCount += chunk;
+    cycles -= chunk;
+    if (jit) {
+      jit->RunCycles(chunk);
+    } else {
+      interpreter.RunCycles(chunk);
+    }
+  }
 }
 
 void CHIP8::Run() {
-  screen.InitSDL();
-
-  uint32_t frameStart = SDL_GetTicks();
-  uint32_t currentTime;
-  uint32_t lastCycleTime = SDL_GetTicks();
-  uint32_t cycleInterval = 1000 / 500;
-
-  while (true) {
-    currentTime = SDL_GetTicks();
-    
-    // Rendering and timer decreasin at 60 Hz
-    if (currentTime - frameStart >= 16) {
-      interpreter.UpdateTimer();
-
-      // Play sound if needed
-      if (interpreter.soundTimer > 0) {
-        if (!sound.isPlaying()) {
-          sound.Play();
+  FrameClock clock;
+  Run(clock);
+}
+
+void CHIP8::Run(FrameClock &clock) {
+  clock.Reset();
+  uint64_t startCycles = cycleCount;
+
+  while (!keypad.quitRequested) {
+    uint32_t due = clock.FramesDue();
+
+    // Sampled right before emulating, not a frame earlier
+    if (due > 0) {
+      PollInput();
+    }
+
+    if (keypad.rewindHeld) {
+      // History plays backwards at the normal frame rate
+      for (uint32_t frame = 0; frame < due; frame++) {
+        rewind.StepBack(*this);
+      }
+    } else if (turbo) {
+      // Emulated frames back to back, the host is refreshed at 60 Hz
+      RunFrame();
+      if (due > 0) {
+        rewind.Capture(*this); // History keeps one frame per host frame
+      }
+    } else {
+      // Every due frame runs, so a late wake-up never drops timer ticks.
+      // Fast-forward runs several per host frame and shows only the last
+      uint32_t speed = fastForward ? fastForwardSpeed : 1;
+      for (uint32_t frame = 0; frame < due; frame++) {
+        for (uint32_t step = 0; step < speed; step++) {
+          RunFrame();
         }
-      } else if (sound.isPlaying()) {
-        sound.Stop();
+        rewind.Capture(*this); // One frame per host frame, as in turbo
       }
+    }
+
+    if (due > 0) {
+      RefreshHost();
+    }
+
+    if (turbo) {
+      // No pacing
+    } else if (input && due > 0 && WaitingForInput()) {
+      // Title screens and finished programs cost nothing until a key
+      input->WaitEvents(InputBackend::FOREVER);
+      HandleHotkeys();
+      clock.Reset();
+    } else {
+      WaitForNextFrame(clock);
+    }
+  }
+
+  DumpProfile();
+
+  if (telemetry) {
+    telemetry->WriteReport(std::cout);
+  }
+
+  if (turbo) {
+    uint64_t instructions = cycleCount - startCycles;
+    double seconds = clock.Elapsed();
+    std::cout << "Executed " << instructions << " instructions in " << seconds
+              << " s (" << instructions / seconds / 1e6 << " MIPS)\n";
+  }
+}
 
-      screen.Render();
-      frameStart = currentTime;
-      Input::HandleInput();
+void CHIP8::WaitForNextFrame(const FrameClock &clock) {
+  // Host events are handled as they arrive, SDL's timeout only has
+  // millisecond resolution so the last fraction is slept precisely
+  if (input) {
+    uint32_t ms;
+    while (!keypad.quitRequested && (ms = clock.MillisUntilNextFrame()) > 0) {
+      input->WaitEvents(ms);
+      HandleHotkeys();
     }
+  }
+  clock.SleepUntilNextFrame();
+}
 
-    // Cycles at 500 Hz
-    if (currentTime - lastCycleTime >= cycleInterval) {
-      interpreter.RunCycle();
-      lastCycleTime = currentTime;
+void CHIP8::RefreshHost() {
+  // Play sound if needed, turbo or fast-forward would only make it stutter
+  if (audio) {
+    audio->SetPattern(interpreter.audioPattern, interpreter.pitch);
+    audio->SetTone(!turbo && !fastForward && interpreter.soundTimer > 0);
+  }
+
+  // Nothing to show unless DXYN or 00E0 ran since the last frame
+  if (video && screen.dirty) {
+    video->Present(screen);
+    screen.dirty = false;
+    if (telemetry) {
+      telemetry->OnPresent();
     }
+  }
 
-    if (Input::quitRequested) {
-      return;
+  if (telemetry) {
+    telemetry->OnHostRefresh();
+    // Overlay refreshed once a second
+    if (video && telemetry->frameTime.Count() % FrameClock::FRAME_RATE == 0) {
+      video->SetOverlayText(telemetry->Summary());
     }
+  }
+}
 
-    SDL_Delay(1); // Limit CPU usage
+void CHIP8::PollInput() {
+  if (input) {
+    input->PollEvents();
+    HandleHotkeys();
+  }
+}
+
+void CHIP8::HandleHotkeys() {
+  if (keypad.TakeHotkey(Hotkey::SaveState)) {
+    if (!quickSave) {
+      quickSave.reset(new MachineState);
+    }
+    CaptureState(*quickSave);
+    if (!stateFile.empty() && WriteState(*quickSave, stateFile.c_str())) {
+      std::cout << "State saved to " << stateFile << "\n";
+    }
+  }
+
+  if (keypad.TakeHotkey(Hotkey::DumpProfile)) {
+    DumpProfile();
+  }
+
+  if (keypad.TakeHotkey(Hotkey::FastForward)) {
+    fastForward = !fastForward;
+    if (video) {
+      video->SetOverlayText(
+          fastForward ? "fast-forward x" + std::to_string(fastForwardSpeed)
+                      : "");
+    }
+  }
+
+  if (keypad.TakeHotkey(Hotkey::LoadState)) {
+    // Falls back to the file, e.g. one saved by an earlier session
+    if (!quickSave && !stateFile.empty()) {
+      std::unique_ptr<MachineState> loaded(new MachineState);
+      if (ReadState(*loaded, stateFile.c_str())) {
+        quickSave = std::move(loaded);
+      }
+    }
+    if (quickSave) {
+      RestoreState(*quickSave);
+    }
+  }
+}
+
+void CHIP8::RunFrame() {
+  RunCycles(instructionsPerFrame);
+  interpreter.UpdateTimer();
+  frameCount++;
+}
+
+bool CHIP8::WaitingForInput() const {
+  return interpreter.idle && !jit && interpreter.delayTimer == 0 &&
+         interpreter.soundTimer == 0 &&
+         keypad.NextEventCycle() == UINT64_MAX && !keypad.rewindHeld;
+}
+
+void CHIP8::RunFrames(uint32_t frames) {
+  for (uint32_t frame = 0; frame < frames; frame++) {
+    RunFrame();
   }
 }
 
@@ -79,7 +277,7 @@ bool CHIP8::ReadRom(const char *filename) {
   file.open(filename, std::ios::in | std::ios::binary);
 
   if (!file) {
-    std::cout << "Error while opening the file\n";
+    std::cerr << "Error while opening the file\n";
     return false;
   }
 
@@ -87,18 +285,123 @@ bool CHIP8::ReadRom(const char *filename) {
   size_t fileSize = file.tellg();
   file.seekg(0, std::ios::beg);
 
-  if (fileSize > (size_t)(MEMORY_SIZE - interpreter.pc)) {
-    std::cout << "ROM is too large to fit on CHIP-8 memory (max file size is "
-                 "3584 bytes)\n";
+  // XO-CHIP programs may fill the 64kb address space
+  if (fileSize > (size_t)(MAX_MEMORY_SIZE - interpreter.pc)) {
+    std::cerr << "ROM is too large to fit on CHIP-8 memory (max file size is "
+              << MAX_MEMORY_SIZE - interpreter.pc << " bytes)\n";
     return false;
   }
+  if (fileSize > (size_t)(memorySize - interpreter.pc)) {
+    SetMemorySize(MAX_MEMORY_SIZE);
+  }
 
   file.read(reinterpret_cast<char *>(&memory[interpreter.pc]), fileSize);
   
   if (!file) {
-    std::cout << "Error while reading the file\n";
+    std::cerr << "Error while reading the file\n";
+    return false;
+  }
+
+  interpreter.InvalidateCache(interpreter.pc, fileSize);
+
+  return true;
+}
+
+bool CHIP8::SetMemorySize(uint32_t size) {
+  if (size != MEMORY_SIZE && size != MAX_MEMORY_SIZE) {
     return false;
   }
 
+  memorySize = size;
+  // Decoded and compiled code may have wrapped at the old size
+  interpreter.InvalidateCache(0, MEMORY_SIZE);
   return true;
 }
+
+void CHIP8::SetQuirks(QuirkProfile profile) {
+  interpreter.quirks = profile;
+  // Cached decodes and blocks were made for the old profile's opcode set
+  interpreter.InvalidateCache(0, MEMORY_SIZE);
+}
+
+bool CHIP8::DumpProfile() const {
+  if (!profile || profileFile.empty()) {
+    return false;
+  }
+
+  if (!profile->WriteFile(profileFile.c_str(), memory)) {
+    return false;
+  }
+  std::cout << "Profile written to " << profileFile << "\n";
+  return true;
+}
+
+void CHIP8::CaptureState(MachineState &state) const {
+  // Only the addressable part, the rest of the state's array is not read
+  memcpy(state.memory, memory, memorySize);
+  state.memorySize = memorySize;
+
+  memcpy(state.V, interpreter.V, sizeof(state.V));
+  state.I = interpreter.I;
+  state.delayTimer = interpreter.delayTimer;
+  state.soundTimer = interpreter.soundTimer;
+  state.pc = interpreter.pc;
+  memcpy(state.stack, interpreter.stack, sizeof(state.stack));
+  state.sp = interpreter.sp;
+  memcpy(state.rng, interpreter.rng.state, sizeof(state.rng));
+  memcpy(state.flags, interpreter.flags, sizeof(state.flags));
+  memcpy(state.audioPattern, interpreter.audioPattern,
+         sizeof(state.audioPattern));
+  state.pitch = interpreter.pitch;
+
+  memcpy(state.framebuffer[0], screen.buffer, sizeof(screen.buffer));
+  memcpy(state.framebuffer[1], screen.buffer2, sizeof(screen.buffer2));
+  state.hires = screen.hires;
+  state.planeMask = screen.planeMask;
+
+  state.cycleCount = cycleCount;
+  state.frameCount = frameCount;
+}
+
+void CHIP8::RestoreState(const MachineState &state) {
+  uint32_t oldSize = memorySize;
+  if (state.memorySize != memorySize) {
+    SetMemorySize(state.memorySize);
+  }
+
+  // Only words that differ drop their decoded instructions, most of the
+  // program is usually the same
+  for (uint32_t addr = 0; addr < state.memorySize; addr += 8) {
+    if (memcmp(&memory[addr], &state.memory[addr], 8) != 0) {
+      memcpy(&memory[addr], &state.memory[addr], 8);
+      interpreter.InvalidateCache(addr, 8);
+    }
+  }
+  // A 64 KB machine restored to 4 KB: the state has no bytes above, clear
+  // what the larger program left there. Nothing above 4 KB is cached.
+  if (oldSize > state.memorySize) {
+    memset(&memory[state.memorySize], 0, oldSize - state.memorySize);
+  }
+
+  memcpy(interpreter.V, state.V, sizeof(state.V));
+  interpreter.I = state.I;
+  interpreter.delayTimer = state.delayTimer;
+  interpreter.soundTimer = state.soundTimer;
+  interpreter.pc = state.pc;
+  memcpy(interpreter.stack, state.stack, sizeof(state.stack));
+  interpreter.sp = state.sp;
+  memcpy(interpreter.rng.state, state.rng, sizeof(state.rng));
+  memcpy(interpreter.flags, state.flags, sizeof(state.flags));
+  memcpy(interpreter.audioPattern, state.audioPattern,
+         sizeof(state.audioPattern));
+  interpreter.pitch = state.pitch;
+
+  memcpy(screen.buffer, state.framebuffer[0], sizeof(screen.buffer));
+  memcpy(screen.buffer2, state.framebuffer[1], sizeof(screen.buffer2));
+  screen.hires = state.hires;
+  screen.planeMask = state.planeMask;
+  screen.dirty = true;
+
+  cycleCount = state.cycleCount;
+  frameCount = state.frameCount;
+}
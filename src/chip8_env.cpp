@@ -0,0 +1,105 @@
+#include "chip8_env.h"
+#include "vec_env.hpp"
+#include <new>
+
+static_assert(CHIP8_ENV_OBSERVATION_WORDS == VecEnv::OBSERVATION_WORDS &&
+                  CHIP8_ENV_HIRES_OBSERVATION_WORDS ==
+                      VecEnv::HIRES_OBSERVATION_WORDS,
+              "C and C++ observation sizes differ");
+
+struct chip8_env {
+  VecEnv vec;
+
+  chip8_env(uint32_t count, unsigned threads) : vec(count, threads) {}
+};
+
+chip8_env *chip8_env_create(const char *rom, uint32_t count,
+                            uint32_t threads) {
+  // Nothing may unwind into C callers
+  try {
+    chip8_env *env = new chip8_env(count, threads);
+    if (!env->vec.ReadRom(rom)) {
+      delete env;
+      return nullptr;
+    }
+    return env;
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+void chip8_env_destroy(chip8_env *env) {
+  delete env;
+}
+
+uint32_t chip8_env_size(const chip8_env *env) {
+  return env->vec.Size();
+}
+
+void chip8_env_set_instructions_per_frame(chip8_env *env, uint32_t ipf) {
+  env->vec.instructionsPerFrame = ipf;
+}
+
+int chip8_env_reset(chip8_env *env, uint64_t seed) {
+  try {
+    env->vec.Reset(seed);
+    return 0;
+  } catch (...) {
+    return -1;
+  }
+}
+
+int chip8_env_reset_one(chip8_env *env, uint32_t index, uint64_t seed) {
+  if (index >= env->vec.Size()) {
+    return -1;
+  }
+  try {
+    env->vec.ResetOne(index, seed);
+    return 0;
+  } catch (...) {
+    return -1;
+  }
+}
+
+int chip8_env_step(chip8_env *env, const uint16_t *actions,
+                   uint32_t frames) {
+  // Worker threads and their task queue may fail to allocate
+  try {
+    env->vec.Step(actions, frames);
+    return 0;
+  } catch (...) {
+    return -1;
+  }
+}
+
+const uint64_t *chip8_env_observe(const chip8_env *env, uint32_t index) {
+  if (index >= env->vec.Size()) {
+    return nullptr;
+  }
+  return env->vec.Observe(index);
+}
+
+int chip8_env_observe_all(const chip8_env *env, uint64_t *out) {
+  try {
+    env->vec.ObserveAll(out);
+    return 0;
+  } catch (...) {
+    return -1;
+  }
+}
+
+int chip8_env_observe_all_hires(const chip8_env *env, uint64_t *out) {
+  try {
+    env->vec.ObserveAllHires(out);
+    return 0;
+  } catch (...) {
+    return -1;
+  }
+}
+
+int chip8_env_hires(const chip8_env *env, uint32_t index) {
+  if (index >= env->vec.Size()) {
+    return -1;
+  }
+  return env->vec.Hires(index);
+}
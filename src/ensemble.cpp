@@ -0,0 +1,464 @@
+#include "ensemble.hpp"
+#include "chip8.hpp"
+#include "screen.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+size_t BuildMaskScalar(const LaneArrays &lanes, uint16_t leader,
+                       uint8_t *mask, size_t *pending) {
+  size_t active = 0, left = 0;
+  for (size_t i = 0; i < lanes.count; i++) {
+    bool hasLeft = lanes.remaining[i] > 0;
+    bool on = hasLeft && lanes.eligible[i] && lanes.pc[i] == leader;
+    mask[i] = on ? 0xFF : 0;
+    active += on;
+    left += hasLeft;
+  }
+  *pending = left;
+  return active;
+}
+
+void StepScalar(LaneArrays &lanes, const DecodedInstruction &ins,
+                const uint8_t *mask) {
+  uint8_t *vx = lanes.V[ins.x];
+  const uint8_t *vy = lanes.V[ins.y];
+  uint8_t *vf = lanes.V[0xF];
+
+  for (size_t i = 0; i < lanes.count; i++) {
+    if (!mask[i]) {
+      continue;
+    }
+
+    uint8_t a = vx[i], b = vy[i];
+    uint16_t next = lanes.pc[i] + 2;
+
+    switch (ins.op) {
+      case OP_JP: next = ins.nnn; break;
+      case OP_SE_BYTE: if (a == ins.nn) next += 2; break;
+      case OP_SNE_BYTE: if (a != ins.nn) next += 2; break;
+      case OP_SE_REG: if (a == b) next += 2; break;
+      case OP_SNE_REG: if (a != b) next += 2; break;
+      case OP_LD_BYTE: vx[i] = ins.nn; break;
+      case OP_ADD_BYTE: vx[i] = a + ins.nn; break;
+      case OP_LD_REG: vx[i] = b; break;
+      case OP_OR: vx[i] = a | b; vf[i] = 0; break;
+      case OP_AND: vx[i] = a & b; vf[i] = 0; break;
+      case OP_XOR: vx[i] = a ^ b; vf[i] = 0; break;
+      case OP_ADD_REG: vx[i] = a + b; vf[i] = (a + b) > 255; break;
+      case OP_SUB: vx[i] = a - b; vf[i] = a >= b; break;
+      case OP_SHR: vx[i] = b >> 1; vf[i] = b & 1; break;
+      case OP_SUBN: vx[i] = b - a; vf[i] = b >= a; break;
+      case OP_SHL: vx[i] = b << 1; vf[i] = b >> 7; break;
+      case OP_LD_I: lanes.I[i] = ins.nnn; break;
+    }
+
+    lanes.pc[i] = next;
+    lanes.remaining[i]--;
+  }
+}
+
+// A group smaller than 1/MIN_GROUP_SHARE of the unfinished instances costs
+// more in full width passes than it saves; the rest of the frame then runs
+// one instance at a time
+constexpr size_t MIN_GROUP_SHARE = 8;
+
+// Instances looked at when picking the next group
+constexpr uint32_t LEADER_SAMPLES = 8;
+
+} // namespace
+
+const LaneKernels SCALAR_LANE_KERNELS = {"scalar", BuildMaskScalar,
+                                         StepScalar};
+
+Ensemble::Ensemble(uint32_t instances)
+    : instructionsPerFrame(CHIP8::CYCLES_PER_FRAME), frameCount(0),
+      lockstepInstructions(0), scalarInstructions(0), skipIdle(true),
+      idleInstructions(0), instances(instances), imageEnd(0x200) {
+  lanes = (instances + LaneArrays::LANE_BLOCK - 1) / LaneArrays::LANE_BLOCK *
+          LaneArrays::LANE_BLOCK;
+
+  for (std::vector<uint8_t> &reg : V) {
+    reg.assign(lanes, 0);
+  }
+  pc.assign(lanes, 0x200);
+  I.assign(lanes, 0);
+  remaining.assign(lanes, 0);
+  eligible.assign(lanes, 0);
+  std::fill(eligible.begin(), eligible.begin() + instances, 0xFF);
+  mask.assign(lanes, 0);
+
+  delayTimer.assign(instances, 0);
+  soundTimer.assign(instances, 0);
+  sp.assign(instances, 0);
+  stack.assign(instances * 16, 0);
+  keys.assign(instances, 0);
+  rng.assign(instances, Rng(0));
+  screen.assign(instances * 32, 0);
+  memory.assign(instances * MEMORY_STRIDE, 0);
+
+  memset(image, 0, sizeof(image));
+  memcpy(&image[CHIP8::FONT_DATA_START], CHIP8::FONT_DATA,
+         sizeof(CHIP8::FONT_DATA));
+  memcpy(&image[CHIP8::BIG_FONT_DATA_START], CHIP8::BIG_FONT_DATA,
+         sizeof(CHIP8::BIG_FONT_DATA));
+  for (uint32_t i = 0; i < instances; i++) {
+    memcpy(&memory[i * MEMORY_STRIDE], image, MEMORY_SIZE);
+  }
+
+  UseVectorKernels(true);
+}
+
+bool Ensemble::UseVectorKernels(bool enable) {
+  const LaneKernels *vector = Avx2LaneKernels();
+  kernels = enable && vector ? vector : &SCALAR_LANE_KERNELS;
+  return !enable || vector;
+}
+
+bool Ensemble::LoadRom(const uint8_t *data, size_t size) {
+  if (size > MEMORY_SIZE - 0x200u) {
+    std::cerr << "ROM is too large to fit on CHIP-8 memory (max file size is "
+                 "3584 bytes)\n";
+    return false;
+  }
+
+  memcpy(&image[0x200], data, size);
+  imageEnd = 0x200 + size;
+
+  for (uint32_t i = 0; i < instances; i++) {
+    memcpy(&memory[i * MEMORY_STRIDE], image, MEMORY_SIZE);
+  }
+  return true;
+}
+
+bool Ensemble::ReadRom(const char *filename) {
+  std::ifstream file(filename, std::ios::binary);
+  if (!file) {
+    std::cerr << "Error while opening the file\n";
+    return false;
+  }
+
+  std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)),
+                            std::istreambuf_iterator<char>());
+  return LoadRom(data.data(), data.size());
+}
+
+void Ensemble::Seed(uint32_t instance, uint64_t seed) {
+  rng[instance].Seed(seed);
+}
+
+void Ensemble::SetKeys(uint32_t instance, uint16_t keys) {
+  this->keys[instance] = keys;
+}
+
+LaneArrays Ensemble::Arrays() {
+  LaneArrays arrays;
+  arrays.count = lanes;
+  for (int x = 0; x < 16; x++) {
+    arrays.V[x] = V[x].data();
+  }
+  arrays.pc = pc.data();
+  arrays.I = I.data();
+  arrays.remaining = remaining.data();
+  arrays.eligible = eligible.data();
+  return arrays;
+}
+
+uint16_t Ensemble::PickLeader() const {
+  // Most common pc among a few evenly spaced unfinished instances
+  uint16_t seen[LEADER_SAMPLES];
+  uint32_t votes[LEADER_SAMPLES];
+  uint32_t distinct = 0;
+  uint32_t stride = std::max<uint32_t>(1, instances / LEADER_SAMPLES);
+
+  for (uint32_t lane = 0; lane < instances && distinct < LEADER_SAMPLES;
+       lane += stride) {
+    if (remaining[lane] == 0 || !eligible[lane]) {
+      continue;
+    }
+    uint32_t j = 0;
+    while (j < distinct && seen[j] != pc[lane]) {
+      j++;
+    }
+    if (j == distinct) {
+      seen[distinct] = pc[lane];
+      votes[distinct++] = 0;
+    }
+    votes[j]++;
+  }
+
+  if (distinct > 0) {
+    return seen[std::max_element(votes, votes + distinct) - votes];
+  }
+
+  // The sample missed the stragglers
+  for (uint32_t lane = 0; lane < instances; lane++) {
+    if (remaining[lane] > 0) {
+      return pc[lane];
+    }
+  }
+  return 0;
+}
+
+void Ensemble::RunFrame() {
+  std::fill(remaining.begin(), remaining.begin() + instances,
+            instructionsPerFrame);
+  LaneArrays arrays = Arrays();
+
+  for (;;) {
+    uint16_t leader = PickLeader();
+    size_t pending;
+    size_t active = kernels->BuildMask(arrays, leader, mask.data(), &pending);
+    if (pending == 0) {
+      break;
+    }
+
+    // Eligible instances have the loaded program at the leader, so the
+    // opcode can come from the shared image
+    bool shared = leader >= 0x200 && leader + 1 < imageEnd;
+    if (!shared || active * MIN_GROUP_SHARE < pending) {
+      for (uint32_t lane = 0; lane < instances; lane++) {
+        RunLaneAlone(lane);
+      }
+      break;
+    }
+
+    DecodedInstruction ins =
+        Interpreter::Decode(image[leader] << 8 | image[leader + 1],
+                            QuirkProfile::CosmacVip);
+
+    if (IsLockstepOp(ins.op)) {
+      kernels->Step(arrays, ins, mask.data());
+    } else {
+      for (uint32_t lane = 0; lane < instances; lane++) {
+        if (mask[lane]) {
+          pc[lane] += 2;
+          ExecuteLane(lane, ins);
+          remaining[lane]--;
+        }
+      }
+    }
+    lockstepInstructions += active;
+
+    if (skipIdle && (ins.op == OP_LD_VX_K || ins.op == OP_LD_VX_DT ||
+                     (ins.op == OP_JP && ins.nnn == leader))) {
+      for (uint32_t lane = 0; lane < instances; lane++) {
+        if (mask[lane]) {
+          SkipIdle(lane, leader, ins);
+        }
+      }
+    }
+  }
+
+  for (uint32_t lane = 0; lane < instances; lane++) {
+    if (delayTimer[lane] > 0)
+      delayTimer[lane]--;
+    if (soundTimer[lane] > 0)
+      soundTimer[lane]--;
+  }
+  frameCount++;
+}
+
+void Ensemble::RunFrames(uint32_t frames) {
+  for (uint32_t i = 0; i < frames; i++) {
+    RunFrame();
+  }
+}
+
+void Ensemble::RunLaneAlone(uint32_t lane) {
+  const uint8_t *mem = &memory[lane * MEMORY_STRIDE];
+
+  while (remaining[lane] > 0) {
+    // Skips from FFE and odd jumps to FFF step past the end too
+    if (pc[lane] >= MEMORY_SIZE) {
+      pc[lane] = 0x200;
+    }
+    uint16_t at = pc[lane];
+    DecodedInstruction ins =
+        Interpreter::Decode(mem[at] << 8 | mem[(at + 1) % MEMORY_SIZE],
+                            QuirkProfile::CosmacVip);
+    pc[lane] += 2;
+    ExecuteLane(lane, ins);
+    remaining[lane]--;
+    scalarInstructions++;
+    if (skipIdle) {
+      SkipIdle(lane, at, ins);
+    }
+  }
+}
+
+// Spends the rest of the frame of an instance in a loop that cannot change
+// anything before the frame ends, whole loops at a time: a jump to itself,
+// FX0A without keys (they only change between frames) or FX07; 3X00; 1NNN
+// polling a running delay timer. Called after the instruction at `at` ran,
+// with the same checks as the Interpreter
+void Ensemble::SkipIdle(uint32_t lane, uint16_t at,
+                        const DecodedInstruction &ins) {
+  const uint8_t *mem = &memory[lane * MEMORY_STRIDE];
+  uint16_t next = pc[lane];
+  uint32_t period;
+
+  switch (ins.op) {
+    case OP_JP:
+      if (ins.nnn != at) {
+        return;
+      }
+      period = 1;
+      break;
+    case OP_LD_VX_K:
+      if (next != at) {
+        return;
+      }
+      period = 1;
+      break;
+    case OP_LD_VX_DT:
+      if (delayTimer[lane] == 0 || next + 4u > MEMORY_SIZE ||
+          mem[next] != (0x30 | ins.x) || mem[next + 1] != 0x00 ||
+          (mem[next + 2] << 8 | mem[next + 3]) != (0x1000 | at)) {
+        return;
+      }
+      period = 3;
+      break;
+    default:
+      return;
+  }
+
+  uint32_t spun = remaining[lane] - remaining[lane] % period;
+  remaining[lane] -= spun;
+  idleInstructions += spun;
+}
+
+void Ensemble::WriteMemory(uint32_t lane, uint16_t address, uint8_t value) {
+  address &= MEMORY_SIZE - 1;
+  memory[lane * MEMORY_STRIDE + address] = value;
+
+  // Its program no longer matches the shared image
+  if (address >= 0x200 && address < imageEnd) {
+    eligible[lane] = 0;
+  }
+}
+
+// Same semantics as Interpreter::Execute, on one instance; pc already
+// points past the instruction
+void Ensemble::ExecuteLane(uint32_t lane, const DecodedInstruction &ins) {
+  uint8_t &vx = V[ins.x][lane];
+  uint8_t &vy = V[ins.y][lane];
+  uint8_t &vf = V[0xF][lane];
+  uint16_t &pc = this->pc[lane];
+  uint16_t &I = this->I[lane];
+  uint16_t *stack = &this->stack[lane * 16];
+  uint8_t &sp = this->sp[lane];
+  const uint8_t *mem = &memory[lane * MEMORY_STRIDE];
+
+  switch (ins.op) {
+    case OP_CLS:
+      memset(&screen[lane * 32], 0, 32 * sizeof(uint64_t));
+      break;
+    case OP_RET:
+      sp = (sp - 1) & 0xF;
+      pc = stack[sp];
+      break;
+    case OP_JP: pc = ins.nnn; break;
+    case OP_CALL:
+      stack[sp] = pc;
+      sp = (sp + 1) & 0xF;
+      pc = ins.nnn;
+      break;
+    case OP_SE_BYTE: if (vx == ins.nn) pc += 2; break;
+    case OP_SNE_BYTE: if (vx != ins.nn) pc += 2; break;
+    case OP_SE_REG: if (vx == vy) pc += 2; break;
+    case OP_LD_BYTE: vx = ins.nn; break;
+    case OP_ADD_BYTE: vx += ins.nn; break;
+    case OP_LD_REG: vx = vy; break;
+    case OP_OR: vx |= vy; vf = 0; break;
+    case OP_AND: vx &= vy; vf = 0; break;
+    case OP_XOR: vx ^= vy; vf = 0; break;
+    case OP_ADD_REG: {
+      uint16_t res = vx + vy;
+      vx = res & 0xFF;
+      vf = res > 255;
+      break;
+    }
+    case OP_SUB: {
+      uint8_t notBorrow = vx >= vy;
+      vx = vx - vy;
+      vf = notBorrow;
+      break;
+    }
+    case OP_SHR: {
+      uint8_t lsb = vy & 1;
+      vx = vy >> 1;
+      vf = lsb;
+      break;
+    }
+    case OP_SUBN: {
+      uint8_t notBorrow = vy >= vx;
+      vx = vy - vx;
+      vf = notBorrow;
+      break;
+    }
+    case OP_SHL: {
+      uint8_t msb = vy >> 7;
+      vx = vy << 1;
+      vf = msb;
+      break;
+    }
+    case OP_SNE_REG: if (vx != vy) pc += 2; break;
+    case OP_LD_I: I = ins.nnn; break;
+    case OP_JP_V0: pc = (V[0][lane] + ins.nnn) % 0x1000; break;
+    case OP_RND: vx = rng[lane].NextByte() & ins.nn; break;
+    case OP_DRW: {
+      uint8_t sprite[16];
+      for (int row = 0; row < ins.n; row++) {
+        sprite[row] = mem[(I + row) & (MEMORY_SIZE - 1)];
+      }
+      vf = 0;
+      if (Screen::DrawRows(&screen[lane * 32], vx, vy, ins.n, sprite)) {
+        vf = 1;
+      }
+      break;
+    }
+    case OP_SKP: if (vx < 16 && (keys[lane] >> vx & 1)) pc += 2; break;
+    case OP_SKNP: if (!(vx < 16 && (keys[lane] >> vx & 1))) pc += 2; break;
+    case OP_LD_VX_DT: vx = delayTimer[lane]; break;
+    case OP_LD_VX_K:
+      if (keys[lane] == 0) {
+        pc -= 2;
+      } else {
+        vx = __builtin_ctz(keys[lane]);
+      }
+      break;
+    case OP_LD_DT_VX: delayTimer[lane] = vx; break;
+    case OP_LD_ST_VX: soundTimer[lane] = vx; break;
+    case OP_ADD_I_VX: I = 0xFFF & (I + vx); break;
+    case OP_LD_F_VX:
+      if (vx < 16) {
+        I = CHIP8::FONT_DATA_START + CHIP8::FONT_SPRITE_HEIGHT * vx;
+      }
+      break;
+    case OP_LD_B_VX: {
+      uint8_t value = vx;
+      WriteMemory(lane, I, value / 100);
+      WriteMemory(lane, I + 1, (value % 100) / 10);
+      WriteMemory(lane, I + 2, value % 10);
+      break;
+    }
+    case OP_LD_I_VX:
+      for (int r = 0; r <= ins.x; r++) {
+        WriteMemory(lane, I + r, V[r][lane]);
+      }
+      I += ins.x + 1;
+      break;
+    case OP_LD_VX_I:
+      for (int r = 0; r <= ins.x; r++) {
+        V[r][lane] = mem[(I + r) & (MEMORY_SIZE - 1)];
+      }
+      I += ins.x + 1;
+      break;
+    default:
+      break;
+  }
+}
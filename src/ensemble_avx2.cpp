@@ -0,0 +1,203 @@
+#include "ensemble_kernels.hpp"
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define CHIP8_ENSEMBLE_AVX2 1
+#endif
+
+#ifdef CHIP8_ENSEMBLE_AVX2
+#include <immintrin.h>
+
+// Everything below is compiled for AVX2 while the rest of the program is
+// not, and only runs once the CPU has been checked. No standard library
+// code is used past this point, so no inline function shared with other
+// files can end up with an AVX2 body.
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2,popcnt"))), \
+                             apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2,popcnt")
+#endif
+
+namespace {
+
+inline __m256i Load(const void *p) {
+  return _mm256_loadu_si256(static_cast<const __m256i *>(p));
+}
+
+inline void Store(void *p, __m256i v) {
+  _mm256_storeu_si256(static_cast<__m256i *>(p), v);
+}
+
+// Narrows two vectors of 16 (or 32) bit masks to bytes, in lane order.
+// The packs work within 128 bit halves, the permute undoes the interleave.
+inline __m256i Pack16(__m256i lo, __m256i hi) {
+  return _mm256_permute4x64_epi64(_mm256_packs_epi16(lo, hi), 0xD8);
+}
+
+inline __m256i Pack32(__m256i lo, __m256i hi) {
+  return _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xD8);
+}
+
+inline int Count(__m256i byteMask) {
+  return _mm_popcnt_u32(static_cast<uint32_t>(_mm256_movemask_epi8(byteMask)));
+}
+
+size_t BuildMask(const LaneArrays &lanes, uint16_t leader, uint8_t *mask,
+                 size_t *pending) {
+  const __m256i lead = _mm256_set1_epi16(static_cast<short>(leader));
+  const __m256i zero = _mm256_setzero_si256();
+  size_t active = 0, left = 0;
+
+  for (size_t i = 0; i < lanes.count; i += LaneArrays::LANE_BLOCK) {
+    __m256i at = Pack16(_mm256_cmpeq_epi16(Load(lanes.pc + i), lead),
+                        _mm256_cmpeq_epi16(Load(lanes.pc + i + 16), lead));
+
+    const uint32_t *r = lanes.remaining + i;
+    __m256i hasLeft =
+        Pack16(Pack32(_mm256_cmpgt_epi32(Load(r), zero),
+                      _mm256_cmpgt_epi32(Load(r + 8), zero)),
+               Pack32(_mm256_cmpgt_epi32(Load(r + 16), zero),
+                      _mm256_cmpgt_epi32(Load(r + 24), zero)));
+
+    __m256i m = _mm256_and_si256(_mm256_and_si256(at, hasLeft),
+                                 Load(lanes.eligible + i));
+    Store(mask + i, m);
+    active += Count(m);
+    left += Count(hasLeft);
+  }
+
+  *pending = left;
+  return active;
+}
+
+void Step(LaneArrays &lanes, const DecodedInstruction &ins,
+          const uint8_t *mask) {
+  uint8_t *vx = lanes.V[ins.x];
+  const uint8_t *vy = lanes.V[ins.y];
+  uint8_t *vf = lanes.V[0xF];
+
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i ones = _mm256_set1_epi8(-1);
+  const __m256i one = _mm256_set1_epi8(1);
+  const __m256i nn = _mm256_set1_epi8(static_cast<char>(ins.nn));
+  const __m256i nnn = _mm256_set1_epi16(static_cast<short>(ins.nnn));
+  const __m256i two = _mm256_set1_epi16(2);
+
+  for (size_t i = 0; i < lanes.count; i += LaneArrays::LANE_BLOCK) {
+    __m256i m = Load(mask + i);
+    if (_mm256_testz_si256(m, m)) {
+      continue;
+    }
+
+    __m256i a = Load(vx + i);
+    __m256i b = Load(vy + i);
+    __m256i skip = zero;          // Lanes whose condition skips
+    __m256i result = a, flag;
+    bool setsFlag = false;
+
+    switch (ins.op) {
+      case OP_SE_BYTE: skip = _mm256_cmpeq_epi8(a, nn); break;
+      case OP_SNE_BYTE: skip = _mm256_xor_si256(_mm256_cmpeq_epi8(a, nn), ones); break;
+      case OP_SE_REG: skip = _mm256_cmpeq_epi8(a, b); break;
+      case OP_SNE_REG: skip = _mm256_xor_si256(_mm256_cmpeq_epi8(a, b), ones); break;
+      case OP_LD_BYTE: result = nn; break;
+      case OP_ADD_BYTE: result = _mm256_add_epi8(a, nn); break;
+      case OP_LD_REG: result = b; break;
+      case OP_OR:
+        result = _mm256_or_si256(a, b); flag = zero; setsFlag = true; break;
+      case OP_AND:
+        result = _mm256_and_si256(a, b); flag = zero; setsFlag = true; break;
+      case OP_XOR:
+        result = _mm256_xor_si256(a, b); flag = zero; setsFlag = true; break;
+      case OP_ADD_REG:
+        // Carry where the saturating sum differs from the wrapping one
+        result = _mm256_add_epi8(a, b);
+        flag = _mm256_andnot_si256(
+            _mm256_cmpeq_epi8(_mm256_adds_epu8(a, b), result), one);
+        setsFlag = true;
+        break;
+      case OP_SUB:
+        result = _mm256_sub_epi8(a, b);
+        flag = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_max_epu8(a, b), a), one);
+        setsFlag = true;
+        break;
+      case OP_SUBN:
+        result = _mm256_sub_epi8(b, a);
+        flag = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_max_epu8(a, b), b), one);
+        setsFlag = true;
+        break;
+      case OP_SHR:
+        // No byte shifts: shift words and drop the bit from the neighbour
+        result = _mm256_and_si256(_mm256_srli_epi16(b, 1), _mm256_set1_epi8(0x7F));
+        flag = _mm256_and_si256(b, one);
+        setsFlag = true;
+        break;
+      case OP_SHL:
+        result = _mm256_add_epi8(b, b);
+        flag = _mm256_and_si256(_mm256_srli_epi16(b, 7), one);
+        setsFlag = true;
+        break;
+    }
+
+    // Vx first, then VF, which wins when x is F like in the interpreter
+    Store(vx + i, _mm256_blendv_epi8(a, result, m));
+    if (setsFlag) {
+      Store(vf + i, _mm256_blendv_epi8(Load(vf + i), flag, m));
+    }
+
+    // pc and I, sixteen lanes at a time
+    skip = _mm256_and_si256(skip, m);
+    for (int half = 0; half < 2; half++) {
+      size_t j = i + 16 * half;
+      __m256i m16 = _mm256_cvtepi8_epi16(half ? _mm256_extracti128_si256(m, 1)
+                                              : _mm256_castsi256_si128(m));
+      __m256i s16 = _mm256_cvtepi8_epi16(half ? _mm256_extracti128_si256(skip, 1)
+                                              : _mm256_castsi256_si128(skip));
+      __m256i pc = Load(lanes.pc + j);
+      if (ins.op == OP_JP) {
+        pc = _mm256_blendv_epi8(pc, nnn, m16);
+      } else {
+        pc = _mm256_add_epi16(pc, _mm256_and_si256(m16, two));
+        pc = _mm256_add_epi16(pc, _mm256_and_si256(s16, two));
+      }
+      Store(lanes.pc + j, pc);
+
+      if (ins.op == OP_LD_I) {
+        Store(lanes.I + j, _mm256_blendv_epi8(Load(lanes.I + j), nnn, m16));
+      }
+    }
+
+    // remaining - 1 on active lanes: the mask is -1 there
+    for (int quarter = 0; quarter < 4; quarter++) {
+      uint32_t *r = lanes.remaining + i + 8 * quarter;
+      __m256i m32 = _mm256_cvtepi8_epi32(
+          _mm_loadl_epi64(reinterpret_cast<const __m128i *>(mask + i + 8 * quarter)));
+      Store(r, _mm256_add_epi32(Load(r), m32));
+    }
+  }
+}
+
+const LaneKernels AVX2_LANE_KERNELS = {"avx2", BuildMask, Step};
+
+} // namespace
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+const LaneKernels *Avx2LaneKernels() {
+  return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")
+             ? &AVX2_LANE_KERNELS
+             : nullptr;
+}
+
+#else
+
+const LaneKernels *Avx2LaneKernels() {
+  return nullptr;
+}
+
+#endif // CHIP8_ENSEMBLE_AVX2
@@ -0,0 +1,56 @@
+#include "frame_clock.hpp"
+#include <thread>
+
+FrameClock::FrameClock() {
+  Reset();
+}
+
+void FrameClock::SleepUntil(Clock::time_point deadline) const {
+  std::this_thread::sleep_until(deadline);
+}
+
+void FrameClock::Reset() {
+  start = Now();
+  frames = 0;
+}
+
+uint32_t FrameClock::FramesDue() {
+  using namespace std::chrono;
+  int64_t elapsed = duration_cast<nanoseconds>(Now() - start).count();
+
+  // Frame 0 is due at start
+  uint64_t due = elapsed * FRAME_RATE / 1000000000 + 1;
+  if (due <= frames) {
+    return 0;
+  }
+
+  uint64_t count = due - frames;
+  if (count > MAX_CATCH_UP) {
+    frames = due - MAX_CATCH_UP;
+    count = MAX_CATCH_UP;
+  }
+
+  frames += count;
+  return count;
+}
+
+FrameClock::Clock::time_point FrameClock::NextDeadline() const {
+  using namespace std::chrono;
+  // Rounded up, so FramesDue() counts the frame once the deadline is met
+  return start + nanoseconds((frames * 1000000000 + FRAME_RATE - 1) /
+                             FRAME_RATE);
+}
+
+void FrameClock::SleepUntilNextFrame() const {
+  SleepUntil(NextDeadline());
+}
+
+uint32_t FrameClock::MillisUntilNextFrame() const {
+  using namespace std::chrono;
+  auto left = duration_cast<milliseconds>(NextDeadline() - Now());
+  return left.count() > 0 ? static_cast<uint32_t>(left.count()) : 0;
+}
+
+double FrameClock::Elapsed() const {
+  return std::chrono::duration<double>(Now() - start).count();
+}
@@ -1,81 +1,78 @@
 #include "input.hpp"
-#include <SDL2/SDL.h>
 
-bool Input::quitRequested = false;
-bool Input::keyState[16] = {false};
+Input::Input()
+    : quitRequested(false), rewindHeld(false), keyState(), pendingHotkeys(0),
+      pressTime() {}
 
-void Input::HandleInput() {
-  SDL_Event e;
-  while (SDL_PollEvent(&e)) {
-    switch (e.type) {
-    case SDL_KEYDOWN:
-    case SDL_KEYUP: {
-      bool isPressed = (e.type == SDL_KEYDOWN);
-      switch (e.key.keysym.scancode) {
-      case SDL_SCANCODE_1:
-        keyState[0x1] = isPressed;
-        break;
-      case SDL_SCANCODE_2:
-        keyState[0x2] = isPressed;
-        break;
-      case SDL_SCANCODE_3:
-        keyState[0x3] = isPressed;
-        break;
-      case SDL_SCANCODE_4:
-        keyState[0xC] = isPressed;
-        break;
-      case SDL_SCANCODE_Q:
-        keyState[0x4] = isPressed;
-        break;
-      case SDL_SCANCODE_W:
-        keyState[0x5] = isPressed;
-        break;
-      case SDL_SCANCODE_E:
-        keyState[0x6] = isPressed;
-        break;
-      case SDL_SCANCODE_R:
-        keyState[0xD] = isPressed;
-        break;
-      case SDL_SCANCODE_A:
-        keyState[0x7] = isPressed;
-        break;
-      case SDL_SCANCODE_S:
-        keyState[0x8] = isPressed;
-        break;
-      case SDL_SCANCODE_D:
-        keyState[0x9] = isPressed;
-        break;
-      case SDL_SCANCODE_F:
-        keyState[0xE] = isPressed;
-        break;
-      case SDL_SCANCODE_Z:
-        keyState[0xA] = isPressed;
-        break;
-      case SDL_SCANCODE_X:
-        keyState[0x0] = isPressed;
-        break;
-      case SDL_SCANCODE_C:
-        keyState[0xB] = isPressed;
-        break;
-      case SDL_SCANCODE_V:
-        keyState[0xF] = isPressed;
-        break;
-      default:
-        break;
-      }
-    } break;
-    case SDL_QUIT: {
-      quitRequested = true;
-      break;
-    }
-    }
+bool Input::IsKeyDown(uint8_t key) const {
+  if (key > 15) {
+    return false;
   }
+
+  return keyState[key];
 }
 
-bool Input::IsKeyDown(uint8_t key) {
+void Input::SetKeyState(uint8_t key, bool pressed) {
   if (key > 15) {
-    return false;
+    return;
   }
 
-  return keyState[key];
+  keyState[key] = pressed;
+}
+
+bool Input::PostKeyEvent(uint64_t cycle, uint8_t key, bool pressed,
+                         uint64_t hostTime) {
+  return events.Push({cycle, key, pressed, hostTime});
+}
+
+void Input::PostOrApplyKeyEvent(uint8_t key, bool pressed,
+                                uint64_t hostTime) {
+  if (PostKeyEvent(NOW, key, pressed, hostTime)) {
+    return;
+  }
+
+  // Everything queued came before this event
+  ApplyEventsUntil(UINT64_MAX);
+  ApplyEvent({NOW, key, pressed, hostTime});
+}
+
+void Input::ApplyEventsUntil(uint64_t cycle) {
+  for (const KeyEvent *event = events.Peek();
+       event && event->cycle <= cycle; event = events.Peek()) {
+    ApplyEvent(*event);
+    events.Pop();
+  }
+}
+
+void Input::ApplyEvent(const KeyEvent &event) {
+  SetKeyState(event.key, event.pressed);
+  if (event.pressed && event.hostTime != 0 && event.key < 16) {
+    pressTime[event.key] = event.hostTime;
+  }
+}
+
+uint64_t Input::NextEventCycle() const {
+  const KeyEvent *event = events.Peek();
+  return event ? event->cycle : UINT64_MAX;
+}
+
+uint64_t Input::TakePressTime(uint8_t key) {
+  if (key > 15) {
+    return 0;
+  }
+
+  uint64_t time = pressTime[key];
+  pressTime[key] = 0;
+  return time;
+}
+
+void Input::PressHotkey(Hotkey hotkey) {
+  pendingHotkeys |= 1u << static_cast<uint8_t>(hotkey);
+}
+
+bool Input::TakeHotkey(Hotkey hotkey) {
+  uint32_t bit = 1u << static_cast<uint8_t>(hotkey);
+  bool pressed = pendingHotkeys & bit;
+  pendingHotkeys &= ~bit;
+  return pressed;
 }
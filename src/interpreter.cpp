@@ -1,11 +1,134 @@
-#include <SDL2/SDL_timer.h>
 #include "interpreter.hpp"
 #include "input.hpp"
 #include "chip8.hpp"
+#include "profile.hpp"
+#include "telemetry.hpp"
+#include <algorithm>
+#include <cstring>
+
+// Threaded dispatch through label addresses where the compiler allows it,
+// a plain switch elsewhere (or when built with -DCHIP8_NO_COMPUTED_GOTO)
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    !defined(CHIP8_NO_COMPUTED_GOTO)
+#define CHIP8_COMPUTED_GOTO 1
+#endif
+
+namespace {
+
+// Handler of a raw opcode under the opcode set of a quirk profile
+template <class Quirks>
+constexpr uint8_t OpOf(uint16_t opcode) {
+  constexpr bool S = Quirks::SCHIP_OPS;
+  constexpr bool XO = Quirks::XO_OPS;
+  switch (opcode >> 12) {
+    // Fixed opcodes
+    case (0x0): {
+      if (opcode == 0x00E0) return OP_CLS;
+      if (opcode == 0x00EE) return OP_RET;
+      // SUPER-CHIP screen control, 00DN from XO-CHIP
+      if (S && (opcode & 0xFFF0) == 0x00C0) return OP_SCD;
+      if (XO && (opcode & 0xFFF0) == 0x00D0) return OP_SCU;
+      if (S && opcode == 0x00FB) return OP_SCR;
+      if (S && opcode == 0x00FC) return OP_SCL;
+      if (S && opcode == 0x00FD) return OP_EXIT;
+      if (S && opcode == 0x00FE) return OP_LOW;
+      if (S && opcode == 0x00FF) return OP_HIGH;
+      return OP_NOP;
+    }
+    case (0x1): return OP_JP;
+    case (0x2): return OP_CALL;
+    case (0x3): return OP_SE_BYTE;
+    case (0x4): return OP_SNE_BYTE;
+    case (0x5): {
+      if (XO && (opcode & 0xF) == 0x2) return OP_SAVE_RANGE;
+      if (XO && (opcode & 0xF) == 0x3) return OP_LOAD_RANGE;
+      return OP_SE_REG;
+    }
+    case (0x6): return OP_LD_BYTE;
+    case (0x7): return OP_ADD_BYTE;
+
+    // 0x8.... Logic arithmetic
+    case (0x8): {
+      switch (opcode & 0xF) {
+        case (0x0): return OP_LD_REG;
+        case (0x1): return OP_OR;
+        case (0x2): return OP_AND;
+        case (0x3): return OP_XOR;
+        case (0x4): return OP_ADD_REG;
+        case (0x5): return OP_SUB;
+        case (0x6): return OP_SHR;
+        case (0x7): return OP_SUBN;
+        case (0xE): return OP_SHL;
+      }
+      return OP_NOP;
+    }
+
+    case (0x9): return OP_SNE_REG;
+    case (0xA): return OP_LD_I;
+    case (0xB): return OP_JP_V0;
+    case (0xC): return OP_RND;
+    case (0xD): {
+      // 16x16 sprites are SUPER-CHIP's; the VIP draws nothing
+      if (!S && (opcode & 0xF) == 0x0) return OP_NOP;
+      return OP_DRW;
+    }
+
+    case (0xE): {
+      if ((opcode & 0xFF) == 0x9E) return OP_SKP;
+      if ((opcode & 0xFF) == 0xA1) return OP_SKNP;
+      return OP_NOP;
+    }
+
+    case (0xF): {
+      // XO-CHIP
+      if (XO && opcode == 0xF000) return OP_LD_I_LONG;
+      if (XO && opcode == 0xF002) return OP_AUDIO;
+      if (XO && (opcode & 0xFF) == 0x01) return OP_PLANE;
+
+      switch (opcode & 0xFF) {
+        case (0x07): return OP_LD_VX_DT;
+        case (0x0A): return OP_LD_VX_K;
+        case (0x15): return OP_LD_DT_VX;
+        case (0x18): return OP_LD_ST_VX;
+        case (0x1E): return OP_ADD_I_VX;
+        case (0x29): return OP_LD_F_VX;
+        case (0x33): return OP_LD_B_VX;
+        case (0x55): return OP_LD_I_VX;
+        case (0x65): return OP_LD_VX_I;
+        case (0x30): return S ? OP_LD_HF_VX : OP_NOP;
+        case (0x3A): return XO ? OP_PITCH : OP_NOP;
+        case (0x75): return S ? OP_SAVE_FLAGS : OP_NOP;
+        case (0x85): return S ? OP_LOAD_FLAGS : OP_NOP;
+      }
+      return OP_NOP;
+    }
+  }
+
+  return OP_NOP;
+}
+
+// Handler for every 16 bit opcode of a profile, built by the compiler
+template <class Quirks>
+struct OpTable {
+  uint8_t op[0x10000];
+
+  constexpr OpTable() : op() {
+    for (uint32_t opcode = 0; opcode < 0x10000; opcode++) {
+      op[opcode] = OpOf<Quirks>(opcode);
+    }
+  }
+};
+
+template <class Quirks>
+constexpr OpTable<Quirks> opTable;
+
+} // namespace
 
 Interpreter::Interpreter(CHIP8 *chip8)
-    : lastTimerUpdate(0), delayTimer(0), soundTimer(0), chip8(chip8),
-      gen(rd()) {
+    : lastTimerUpdate(0), V(), I(0), delayTimer(0), soundTimer(0), stack(),
+      sp(0), flags(), audioPattern(), pitch(64), chip8(chip8), rng(0),
+      quirks(QuirkProfile::CosmacVip), skipIdle(true), idle(false),
+      idleCycles(0), cache() {
   pc = 0x200;
 }
 
@@ -16,316 +139,673 @@ void Interpreter::UpdateTimer() {
     soundTimer--;
 }
 
+template <class Quirks>
+DecodedInstruction Interpreter::Decode(uint16_t opcode) {
+  DecodedInstruction ins;
+  ins.nnn = opcode & 0x0FFF;
+  ins.x = (opcode & 0x0F00) >> 8;
+  ins.y = (opcode & 0x00F0) >> 4;
+  ins.n = opcode & 0x000F;
+  ins.nn = opcode & 0x00FF;
+  ins.op = opTable<Quirks>.op[opcode];
+  return ins;
+}
+
+DecodedInstruction Interpreter::Decode(uint16_t opcode,
+                                       QuirkProfile profile) {
+  switch (profile) {
+  case QuirkProfile::SuperChip:
+    return Decode<SuperChipQuirks>(opcode);
+  case QuirkProfile::XoChip:
+    return Decode<XoChipQuirks>(opcode);
+  default:
+    return Decode<CosmacVipQuirks>(opcode);
+  }
+}
+
 void Interpreter::DecodeAndExecute(uint16_t opcode) {
-  // Variable opcodes
-  switch (opcode >> 12) {
-    // Fixed opcodes
-    case (0): {
-      // 0x00E0 CLS Clear Screen
-      if (opcode == 0x00E0) {
-        chip8->screen.Clear();
-      }
+  DecodedInstruction ins = Decode(opcode, quirks);
+  Dispatch(0, &ins);
+}
 
-      // RET return from subroutine
-      if (opcode == 0x00EE) {
-        // PC is top of stack, sp decremeted
-        pc = stack[--sp] + 0;
-      }
-      break;
-    }
-    
-    // 0x1NNN JMP to addr
-    case (0x1): {
-      pc = opcode & 0x0FFF;
-      break;
-    }
+uint8_t Interpreter::FetchByte() {
+  return chip8->memory[pc++];
+}
 
-    // 0x2NNN CALL a subroutine located in NNN
-    case (0x2): {
-      uint16_t subroutine = 0x0FFF & opcode;
-      stack[sp] = pc; // Push
-      sp++; 
-      pc = subroutine;
-      break;
-    }
-    
-    // 0x3XNN SE Vx, NN. Skip if Vx equal NN
-    case (0x3): {
-      uint8_t regIdx = (opcode & 0x0F00) >> 8;
-      bool flag = (opcode & 0x00FF) == V[regIdx];
-      if (flag) pc += 2;
-      break;
-    }
+void Interpreter::RunCycle() {
+  Dispatch(1, nullptr);
+}
 
-    // 0x4XNN SNE Vx, NN. Skip if Vx not equal NN
-    case (0x4): {
-      uint8_t regIdx = (opcode & 0x0F00) >> 8;
-      bool flag = (opcode & 0x00FF) != V[regIdx];
-      if (flag) pc += 2;
-      break;
-    }
+void Interpreter::RunCycles(uint32_t cycles) {
+  Dispatch(cycles, nullptr);
+}
 
-    // 0x5XY0 SE Vx, Vy. Skip if Vx equal Vy
-    case (0x5): {
-      uint8_t regX = (opcode & 0x0F00) >> 8;
-      uint8_t regY = (opcode & 0x00F0) >> 4;
-      bool flag = V[regX] == V[regY];
-      if (flag) pc += 2;
-      break;
-    }
+void Interpreter::Dispatch(uint32_t cycles, const DecodedInstruction *single) {
+  switch (quirks) {
+  case QuirkProfile::SuperChip:
+    Execute<SuperChipQuirks>(cycles, single);
+    break;
+  case QuirkProfile::XoChip:
+    Execute<XoChipQuirks>(cycles, single);
+    break;
+  default:
+    Execute<CosmacVipQuirks>(cycles, single);
+    break;
+  }
+}
 
-    // 0x6XNN LOAD X with NN
-    case (0x6): {
-      uint8_t reg = (0x0F00 & opcode) >> 8;
-      uint8_t value = (0x00FF & opcode);
-      V[reg] = value;
-      break;
-    }
+void Interpreter::InvalidateCache(uint16_t address, uint16_t length) {
+  // The instruction starting one byte before also reads address
+  int first = std::max<int>(address - 1, CACHE_START);
+  int last = std::min<int>(address + length, CACHE_END);
 
-    // 0x7XNN ADDS NN to X
-    case (0x7): {
-      uint8_t reg = (0x0F00 & opcode) >> 8;
-      uint8_t value = (0x00FF & opcode);
-      V[reg] += value;
-      break;
-    }
+  for (int addr = first; addr < last; addr++) {
+    cache[addr - CACHE_START].op = OP_DECODE;
+  }
 
-    // 0x8.... Logic arithmetic
-    case (0x8): {
-      ExecuteLogicArithmetic(opcode);
-      break;
-    }
+  if (chip8->jit) {
+    chip8->jit->Invalidate(address, length);
+  }
+}
 
-    // 0x9XY0 SNE Vx, Vy
-    case (0x9): {
-      uint8_t Vx = V[(opcode & 0xF00) >> 8];
-      uint8_t Vy = V[(opcode & 0xF0) >> 4];
-      if (Vx != Vy)
-        pc += 2;
-      break;
-    }
+void Interpreter::WriteMemory(uint16_t address, const uint8_t *data,
+                              uint16_t length) {
+  uint32_t size = chip8->memorySize;
+  if (address + length <= size) {
+    memcpy(&chip8->memory[address], data, length);
+    InvalidateCache(address, length);
+    return;
+  }
 
-    // 0xANNN LOAD I, addr
-    case (0xA): {
-      uint16_t newIdx = 0x0FFF & opcode;
-      I = newIdx;
-      break;
-    }
+  for (uint16_t i = 0; i < length; i++) {
+    uint16_t at = (address + i) & (size - 1);
+    chip8->memory[at] = data[i];
+    InvalidateCache(at, 1);
+  }
+}
 
-    // 0xBNNN JP V0, addr
-    case (0xB): {
-      uint16_t offset = 0x0FFF & opcode;
-      pc = (V[0] + offset) % 0x1000;
-      break;
-    }
+void Interpreter::ReadMemory(uint16_t address, uint8_t *data,
+                             uint16_t length) const {
+  uint32_t size = chip8->memorySize;
+  if (address + length <= size) {
+    memcpy(data, &chip8->memory[address], length);
+    return;
+  }
 
-    // 0xCXNN RND VX, NN
-    case (0xC): {
-      uint8_t x = (0x0F00 & opcode) >> 8;
-      std::uniform_int_distribution<uint8_t> dist(0, 255);
-      uint8_t rnd = dist(gen);
-      uint8_t newVx = rnd & (0xFF & opcode);
-      V[x] = newVx;
-      break;
-    }
+  for (uint16_t i = 0; i < length; i++) {
+    data[i] = chip8->memory[(address + i) & (size - 1)];
+  }
+}
 
-    // 0xDXYN Draw
-    case (0xD): {
-      V[0xF] = 0; // Reset status register
-      uint8_t x = V[(opcode & 0x0F00) >> 8]; // Sprite coordinates
-      uint8_t y = V[(opcode & 0x00F0) >> 4]; // ...
-      uint8_t height = opcode & 0x000F; // N of bytes (lines) of sprite
-      chip8->screen.drawSprite(x, y, height, &chip8->memory[I]);
-      break;
-    }
+template <class Quirks>
+void Interpreter::Execute(uint32_t cycles, const DecodedInstruction *single) {
+  uint8_t *memory = chip8->memory;
+  const uint32_t memorySize = chip8->memorySize;
+  const uint16_t addressMask = memorySize - 1;
+  const DecodedInstruction *ins = single;
+  DecodedInstruction uncached;
+
+  // Local copy of the member so it can live in a register; byte stores to
+  // V and memory would otherwise force reloads after every instruction
+  uint16_t pc = this->pc;
+
+  // Counter updates vanish unless built with CHIP8_PROFILE
+  Profile *profile = chip8->profile.get();
+#define PROFILE(statement)                                                  \
+  do {                                                                      \
+    if constexpr (PROFILING) {                                              \
+      statement;                                                            \
+    }                                                                       \
+  } while (0)
+
+  // Points ins at the instruction at pc and advances pc. Both bytes must be
+  // inside the cached area, anything else is decoded on the spot.
+#define FETCH()                                                             \
+  do {                                                                      \
+    if (pc >= memorySize) {                                                 \
+      pc = 0x200;                                                           \
+    }                                                                       \
+    if (pc >= CACHE_START && pc < CACHE_END - 1) {                          \
+      ins = &cache[pc - CACHE_START];                                       \
+    } else {                                                                \
+      uncached = Decode<Quirks>(memory[pc] << 8 |                           \
+                                memory[(pc + 1) & addressMask]);            \
+      ins = &uncached;                                                      \
+    }                                                                       \
+    PROFILE(profile->pcCounts[pc]++;                                        \
+            profile->pcFunction[pc] = profile->CurrentFunction());          \
+    pc += 2;                                                                \
+  } while (0)
+
+  // Taken skips step over a whole instruction, F000 NNNN being 4 bytes
+  // where XO-CHIP has it
+#define SKIP()                                                              \
+  do {                                                                      \
+    pc += (Quirks::LONG_SKIP && memory[pc & addressMask] == 0xF0 &&         \
+           memory[(pc + 1) & addressMask] == 0x00)                          \
+              ? 4 : 2;                                                      \
+  } while (0)
+
+  // Spends the remaining cycles of a loop `period` instructions long that
+  // cannot change anything before they run out, whole periods at a time
+#define SPIN(period)                                                        \
+  do {                                                                      \
+    spun = cycles - cycles % (period);                                      \
+    cycles -= spun;                                                         \
+    idleCycles += spun;                                                     \
+    idle = true;                                                            \
+  } while (0)
+  uint32_t spun;
+  idle = false;
+
+#ifdef CHIP8_COMPUTED_GOTO
+  static void *const labels[OP_COUNT] = {
+#define CHIP8_OP_LABEL(name) &&op_##name,
+      CHIP8_OPS(CHIP8_OP_LABEL)
+#undef CHIP8_OP_LABEL
+  };
+
+  // Each handler ends with its own copy of fetch and dispatch
+#define OP(name) op_##name
+#define DISPATCH()                                                          \
+  do {                                                                      \
+    PROFILE(profile->opCounts[ins->op]++);                                  \
+    goto *labels[ins->op];                                                  \
+  } while (0)
+#define NEXT()                                                              \
+  do {                                                                      \
+    if (cycles == 0) {                                                      \
+      this->pc = pc;                                                        \
+      return;                                                               \
+    }                                                                       \
+    cycles--;                                                               \
+    FETCH();                                                                \
+    DISPATCH();                                                             \
+  } while (0)
+
+  if (ins == nullptr) {
+    NEXT();
+  }
+  DISPATCH();
+#else
+#define OP(name) case OP_##name
+#define DISPATCH() goto dispatch
+#define NEXT() goto next
+
+  if (ins != nullptr) {
+    goto dispatch;
+  }
 
-    // 0xEX__ Check if pressed
-    case (0xE): {
-      uint8_t x = (0x0F00 & opcode) >> 8;
-      uint8_t mode = (0xFF & opcode);
-      bool pressed = Input::IsKeyDown(V[x]);
-      
-      // SKP Vx or SKNP Vx
-      if ((mode == 0x9E && pressed) || (mode == 0xA1 && !pressed)) {
-        pc += 2;
-      } 
-      break;
-    }
+next:
+  if (cycles == 0) {
+    this->pc = pc;
+    return;
+  }
+  cycles--;
+  FETCH();
+
+dispatch:
+  PROFILE(profile->opCounts[ins->op]++);
+  switch (ins->op) {
+#endif
+
+  // Cache miss: decode the entry in place and run it
+  OP(DECODE): {
+    uint16_t addr = pc - 2;
+    cache[addr - CACHE_START] =
+        Decode<Quirks>(memory[addr] << 8 | memory[addr + 1]);
+    DISPATCH();
+  }
 
-    case (0xF): {
-      uint8_t x = (0x0F00 & opcode) >> 8;
-      uint8_t mode = 0xFF & opcode;
-      ExecuteFxInstruction(x, mode);
-      break;
+  OP(NOP): {
+    NEXT();
+  }
+
+  // 0x00E0 CLS Clear Screen
+  OP(CLS): {
+    chip8->screen.Clear();
+    if (Telemetry *telemetry = chip8->telemetry.get()) {
+      telemetry->OnScreenChange();
     }
-  }  
-}
+    NEXT();
+  }
 
-void Interpreter::ExecuteLogicArithmetic(uint16_t opcode) {
-  uint8_t mode = 0xF & opcode;
-  uint8_t x = (opcode & 0x0F00) >> 8;
-  uint8_t y = (opcode & 0x00F0) >> 4;
+  // 0x00EE RET return from subroutine
+  OP(RET): {
+    // PC is top of stack, sp decremeted
+    pc = stack[--sp] + 0;
+    PROFILE(profile->Return());
+    NEXT();
+  }
 
-  switch (mode) {
-    // LD Vx, Vy
-    case (0): {
-      V[x] = V[y];
-      break;
+  // 0x1NNN JMP to addr
+  OP(JP): {
+    if (ins->nnn == pc - 2 && cycles > 0 && skipIdle) {
+      SPIN(1);
+      PROFILE(profile->pcCounts[pc - 2] += spun;
+              profile->opCounts[OP_JP] += spun);
     }
+    pc = ins->nnn;
+    NEXT();
+  }
 
-    // OR Vx, Vy
-    case (1): {
-      V[x] |= V[y];
+  // 0x2NNN CALL a subroutine located in NNN
+  OP(CALL): {
+    stack[sp] = pc; // Push
+    sp++;
+    pc = ins->nnn;
+    PROFILE(profile->Call(pc));
+    NEXT();
+  }
+
+  // 0x3XNN SE Vx, NN. Skip if Vx equal NN
+  OP(SE_BYTE): {
+    if (V[ins->x] == ins->nn) SKIP();
+    NEXT();
+  }
+
+  // 0x4XNN SNE Vx, NN. Skip if Vx not equal NN
+  OP(SNE_BYTE): {
+    if (V[ins->x] != ins->nn) SKIP();
+    NEXT();
+  }
+
+  // 0x5XY0 SE Vx, Vy. Skip if Vx equal Vy
+  OP(SE_REG): {
+    if (V[ins->x] == V[ins->y]) SKIP();
+    NEXT();
+  }
+
+  // 0x6XNN LOAD X with NN
+  OP(LD_BYTE): {
+    V[ins->x] = ins->nn;
+    NEXT();
+  }
+
+  // 0x7XNN ADDS NN to X
+  OP(ADD_BYTE): {
+    V[ins->x] += ins->nn;
+    NEXT();
+  }
+
+  // 0x8XY0 LD Vx, Vy
+  OP(LD_REG): {
+    V[ins->x] = V[ins->y];
+    NEXT();
+  }
+
+  // 0x8XY1 OR Vx, Vy
+  OP(OR): {
+    V[ins->x] |= V[ins->y];
+    if constexpr (Quirks::VF_RESET) {
       V[0xF] = 0;
-      break;
     }
+    NEXT();
+  }
 
-    // AND Vx, Vy
-    case (2): {
-      V[x] &= V[y];
+  // 0x8XY2 AND Vx, Vy
+  OP(AND): {
+    V[ins->x] &= V[ins->y];
+    if constexpr (Quirks::VF_RESET) {
       V[0xF] = 0;
-      break;
     }
+    NEXT();
+  }
 
-    // XOR Vx, Vy
-    case (3): {
-      V[x] ^= V[y];
+  // 0x8XY3 XOR Vx, Vy
+  OP(XOR): {
+    V[ins->x] ^= V[ins->y];
+    if constexpr (Quirks::VF_RESET) {
       V[0xF] = 0;
-      break;
     }
+    NEXT();
+  }
 
-    // ADD Vx, Vy
-    case (4): {
-      uint16_t res = V[x] + V[y];
-      V[x] = res & 0xFF;  // Store the lower 8 bits of the result
-      V[0xF] = (res > 255);  // Set VF flag for overflow
-      break;
-    }
+  // 0x8XY4 ADD Vx, Vy
+  OP(ADD_REG): {
+    uint16_t res = V[ins->x] + V[ins->y];
+    V[ins->x] = res & 0xFF;  // Store the lower 8 bits of the result
+    V[0xF] = (res > 255);    // Set VF flag for overflow
+    NEXT();
+  }
+
+  // 0x8XY5 SUB Vx, Vy
+  OP(SUB): {
+    uint8_t res = V[ins->x] - V[ins->y];
+    uint8_t notBorrow = (V[ins->x] >= V[ins->y]) ? 1 : 0;
+    V[ins->x] = res;
+    V[0xF] = notBorrow;
+    NEXT();
+  }
+
+  // 0x8XY6 SHR Vx {, Vy}
+  OP(SHR): {
+    uint8_t value = V[Quirks::SHIFT_VY ? ins->y : ins->x];
+    uint8_t lsb = value & 1;      // least significant bit
+    V[ins->x] = value >> 1;       // Shift right
+    V[0xF] = lsb;
+    NEXT();
+  }
 
-    // SUB Vx, Vy
-    case (5): {
-      uint8_t res = V[x] - V[y];
-      uint8_t notBorrow = (V[x] >= V[y]) ? 1 : 0; 
-      V[x] = res;
-      V[0xF] = notBorrow;
-      break;
+  // 0x8XY7 SUBN Vx, Vy
+  OP(SUBN): {
+    uint8_t res = V[ins->y] - V[ins->x];
+    uint8_t notBorrow = (V[ins->y] >= V[ins->x]) ? 1 : 0;
+    V[ins->x] = res;
+    V[0xF] = notBorrow; // Set VF flag for not borrow
+    NEXT();
+  }
+
+  // 0x8XYE SHL Vx {, Vy}
+  OP(SHL): {
+    uint8_t value = V[Quirks::SHIFT_VY ? ins->y : ins->x];
+    uint8_t msb = (value & 0x80) >> 7;      // Most significant bit
+    V[ins->x] = value << 1;                 // Shift left
+    V[0xF] = msb;
+    NEXT();
+  }
+
+  // 0x9XY0 SNE Vx, Vy
+  OP(SNE_REG): {
+    if (V[ins->x] != V[ins->y]) SKIP();
+    NEXT();
+  }
+
+  // 0xANNN LOAD I, addr
+  OP(LD_I): {
+    I = ins->nnn;
+    NEXT();
+  }
+
+  // 0xBNNN JP V0, addr (BXNN JP Vx, addr on SUPER-CHIP)
+  OP(JP_V0): {
+    pc = (V[Quirks::JUMP_VX ? ins->x : 0] + ins->nnn) & addressMask;
+    NEXT();
+  }
+
+  // 0xCXNN RND VX, NN
+  OP(RND): {
+    V[ins->x] = rng.NextByte() & ins->nn;
+    NEXT();
+  }
+
+  // 0xDXYN Draw
+  OP(DRW): {
+    V[0xF] = 0; // Reset status register
+    uint8_t x = V[ins->x]; // Sprite coordinates
+    uint8_t y = V[ins->y]; // ...
+    // N of bytes (lines) of sprite, 16x16 when N is 0
+    uint16_t bytes = chip8->screen.SpriteBytes(ins->n);
+    const uint8_t *sprite = &memory[I];
+    uint8_t wrapped[64];
+    if (I + bytes > memorySize) {
+      ReadMemory(I, wrapped, bytes);
+      sprite = wrapped;
+    }
+    chip8->screen.drawSprite<Quirks::WRAP_SPRITES>(x, y, ins->n, sprite);
+    if (Telemetry *telemetry = chip8->telemetry.get()) {
+      telemetry->OnScreenChange();
+    }
+    PROFILE(profile->draws++);
+    NEXT();
+  }
+
+  // 0xEX9E SKP Vx
+  OP(SKP): {
+    if (Telemetry *telemetry = chip8->telemetry.get()) {
+      telemetry->OnKeyRead(chip8->keypad, V[ins->x]);
     }
+    if (chip8->keypad.IsKeyDown(V[ins->x])) SKIP();
+    NEXT();
+  }
 
-    // SHR Vx {, Vy}
-    case (6): {
-      uint8_t lsb = V[y] & 1;  // least significant bit
-      V[x] = V[y];
-      V[x] >>= 1; // Shift right
-      V[0xF] = lsb;
-      break;
+  // 0xEXA1 SKNP Vx
+  OP(SKNP): {
+    if (Telemetry *telemetry = chip8->telemetry.get()) {
+      telemetry->OnKeyRead(chip8->keypad, V[ins->x]);
     }
+    if (!chip8->keypad.IsKeyDown(V[ins->x])) SKIP();
+    NEXT();
+  }
 
-    // SUBN Vx, Vy
-    case (7): {
-      uint8_t res = V[y] - V[x];
-      uint8_t notBorrow = (V[y] >= V[x]) ? 1 : 0;
-      V[x] = res;
-      V[0xF] = notBorrow; // Set VF flag for not borrow 
-      break;
+  // 0xFX07 LD Vx, DT
+  OP(LD_VX_DT): {
+    V[ins->x] = delayTimer;
+    // FX07; 3X00; 1NNN back to FX07 polls until the next timer tick
+    if (delayTimer != 0 && cycles >= 3 && skipIdle &&
+        pc + 4u <= memorySize &&
+        memory[pc] == (0x30 | ins->x) && memory[pc + 1] == 0x00 &&
+        (memory[pc + 2] << 8 | memory[pc + 3]) == (0x1000 | (pc - 2))) {
+      SPIN(3);
+      PROFILE(profile->pcCounts[pc - 2] += spun / 3;
+              profile->pcCounts[pc] += spun / 3;
+              profile->pcCounts[pc + 2] += spun / 3;
+              profile->opCounts[OP_LD_VX_DT] += spun / 3;
+              profile->opCounts[OP_SE_BYTE] += spun / 3;
+              profile->opCounts[OP_JP] += spun / 3);
+    }
+    NEXT();
+  }
+
+  // 0xFX0A LD Vx, K
+  OP(LD_VX_K): {
+    bool waitingForKey = true;
+
+    for (int key = 0; key < 16; key++) {
+      if (chip8->keypad.IsKeyDown(key)) {
+        if (Telemetry *telemetry = chip8->telemetry.get()) {
+          telemetry->OnKeyRead(chip8->keypad, key);
+        }
+        V[ins->x] = key;
+        waitingForKey = false;
+        break;
+      }
     }
 
-    // SHL Vx {, Vy}
-    case (0xE): {
-      uint8_t msb = (V[y] & 0x80) >> 7;  // Most significant bit
-      V[x] = V[y];
-      V[x] <<= 1; // Shift left
-      V[0xF] = msb;
-      break;
+    if (waitingForKey) {
+      pc -= 2;
+      // Keys only change between runs
+      if (cycles > 0 && skipIdle) {
+        SPIN(1);
+        PROFILE(profile->pcCounts[pc] += spun;
+                profile->opCounts[OP_LD_VX_K] += spun);
+      }
     }
+    NEXT();
   }
-}
 
-uint8_t Interpreter::FetchByte() {
-  return chip8->memory[pc++];
-}
+  // 0xFX15 LD DT, Vx
+  OP(LD_DT_VX): {
+    delayTimer = V[ins->x];
+    NEXT();
+  }
 
-void Interpreter::RunCycle() {
-  if (pc == CHIP8::MEMORY_SIZE) {
-    pc = 0x200;
+  // 0xFX18 LD ST, Vx
+  OP(LD_ST_VX): {
+    soundTimer = V[ins->x];
+    NEXT();
   }
 
-  uint16_t opcode = FetchByte() << 8 | FetchByte();
-  DecodeAndExecute(opcode);
-}
+  // 0xFX1E ADD I, Vx
+  OP(ADD_I_VX): {
+    I = addressMask & (I + V[ins->x]);
+    NEXT();
+  }
 
-void Interpreter::ExecuteFxInstruction(uint8_t x, uint8_t mode) {
-  switch (mode) {
-    // LD Vx, DT
-    case (7): {
-      V[x] = delayTimer;
-      break;
+  // 0xFX29 LD F, Vx
+  OP(LD_F_VX): {
+    if (V[ins->x] < 16) {
+      I = CHIP8::FONT_DATA_START + CHIP8::FONT_SPRITE_HEIGHT * V[ins->x];
     }
+    NEXT();
+  }
 
-    // LD Vx, K
-    case (0xA): {
-      bool waitingForKey = true;
+  // 0xFX33 LD B, Vx
+  OP(LD_B_VX): {
+    uint8_t value = V[ins->x];
+    uint8_t hundreds = value / 100;
+    uint8_t dozens = (value % 100) / 10;
+    uint8_t ones = value % 10;
+    uint8_t digits[3] = {hundreds, dozens, ones};
+    WriteMemory(I, digits, 3);
+    PROFILE(profile->memoryWrites += 3);
+    NEXT();
+  }
 
-      for (int key = 0; key < 16; key++) {
-        if (Input::IsKeyDown(key)) {
-          V[x] = key;
-          waitingForKey = false;
-          break;
-        }  
-      }
-      
-      if (waitingForKey) {
-        pc -= 2;
-      }
-      break;
+  // 0xFX55 LD [I], Vx
+  OP(LD_I_VX): {
+    // Invalidation only resets the op, x survives even if this
+    // instruction overwrites itself
+    WriteMemory(I, V, ins->x + 1);
+    PROFILE(profile->memoryWrites += ins->x + 1);
+    if constexpr (Quirks::INCREMENT_I) {
+      I += ins->x + 1;
     }
+    NEXT();
+  }
 
-    // LD DT, Vx
-    case (0x15): {
-      delayTimer = V[x];
-      break;
+  // 0xFX65 LD Vx, [I]
+  OP(LD_VX_I): {
+    ReadMemory(I, V, ins->x + 1);
+    if constexpr (Quirks::INCREMENT_I) {
+      I += ins->x + 1;
     }
+    NEXT();
+  }
 
-    // LD ST, Vx
-    case (0x18): {
-      soundTimer = V[x];
-      break;
+  // 0x00CN SCD N, scroll down N lines
+  OP(SCD): {
+    chip8->screen.ScrollDown(ins->n);
+    if (Telemetry *telemetry = chip8->telemetry.get()) {
+      telemetry->OnScreenChange();
     }
+    NEXT();
+  }
 
-    // LD F, Vx
-    case (0x29): {
-      if (V[x] < 16) {
-        I = CHIP8::FONT_DATA_START + CHIP8::FONT_SPRITE_HEIGHT * V[x];
-      }
-      break;
+  // 0x00DN SCU N, scroll up N lines
+  OP(SCU): {
+    chip8->screen.ScrollUp(ins->n);
+    if (Telemetry *telemetry = chip8->telemetry.get()) {
+      telemetry->OnScreenChange();
     }
+    NEXT();
+  }
 
-    // LD Vx, [I]
-    case (0x65): {
-      memcpy(V, &chip8->memory[I], (x + 1) * sizeof(uint8_t));
-      I += x + 1;
-      break;
+  // 0x00FB SCR, scroll right 4 pixels
+  OP(SCR): {
+    chip8->screen.ScrollRight();
+    if (Telemetry *telemetry = chip8->telemetry.get()) {
+      telemetry->OnScreenChange();
     }
-   
-    // LD [I], Vx
-    case (0x55): {
-      memcpy(&chip8->memory[I], V, (x + 1) * sizeof(uint8_t));
-      I += x + 1;
-      break;
+    NEXT();
+  }
+
+  // 0x00FC SCL, scroll left 4 pixels
+  OP(SCL): {
+    chip8->screen.ScrollLeft();
+    if (Telemetry *telemetry = chip8->telemetry.get()) {
+      telemetry->OnScreenChange();
     }
+    NEXT();
+  }
+
+  // 0x00FD EXIT, stays on this instruction
+  OP(EXIT): {
+    pc -= 2;
+    NEXT();
+  }
 
-    case (0x1E): {
-      I = 0xFFF & (I + V[x]);
-      break;
+  // 0x00FE LOW / 0x00FF HIGH, 64x32 or 128x64
+  OP(LOW): {
+    chip8->screen.SetHires(false);
+    NEXT();
+  }
+
+  OP(HIGH): {
+    chip8->screen.SetHires(true);
+    NEXT();
+  }
+
+  // 0xFX30 LD HF, Vx: big digit sprite
+  OP(LD_HF_VX): {
+    if (V[ins->x] < 16) {
+      I = CHIP8::BIG_FONT_DATA_START +
+          CHIP8::BIG_FONT_SPRITE_HEIGHT * V[ins->x];
     }
+    NEXT();
+  }
+
+  // 0xFX75 LD R, Vx
+  OP(SAVE_FLAGS): {
+    memcpy(flags, V, ins->x + 1);
+    NEXT();
+  }
+
+  // 0xFX85 LD Vx, R
+  OP(LOAD_FLAGS): {
+    memcpy(V, flags, ins->x + 1);
+    NEXT();
+  }
+
+  // 0x5XY2 save Vx..Vy at I, descending when x > y; I stays
+  OP(SAVE_RANGE): {
+    int step = ins->x <= ins->y ? 1 : -1;
+    int count = (ins->x <= ins->y ? ins->y - ins->x : ins->x - ins->y) + 1;
+    uint8_t values[16];
+    for (int i = 0; i < count; i++) {
+      values[i] = V[ins->x + i * step];
+    }
+    WriteMemory(I, values, count);
+    PROFILE(profile->memoryWrites += count);
+    NEXT();
+  }
 
-    case (0x33): {
-      uint8_t hundreds = V[x] / 100;
-      uint8_t dozens = (V[x] % 100) / 10;
-      uint8_t ones = V[x] % 10;
-      chip8->memory[I] = hundreds;
-      chip8->memory[I+1] = dozens;
-      chip8->memory[I+2] = ones;
-      break;
+  // 0x5XY3 load Vx..Vy from I
+  OP(LOAD_RANGE): {
+    int step = ins->x <= ins->y ? 1 : -1;
+    int count = (ins->x <= ins->y ? ins->y - ins->x : ins->x - ins->y) + 1;
+    uint8_t values[16];
+    ReadMemory(I, values, count);
+    for (int i = 0; i < count; i++) {
+      V[ins->x + i * step] = values[i];
     }
+    NEXT();
+  }
+
+  // 0xF000 NNNN LD I, long address in the next word
+  OP(LD_I_LONG): {
+    I = memory[pc & addressMask] << 8 | memory[(pc + 1) & addressMask];
+    pc += 2;
+    NEXT();
+  }
+
+  // 0xFN01 PLANE N, planes drawn, cleared and scrolled
+  OP(PLANE): {
+    chip8->screen.planeMask = ins->x & 3;
+    NEXT();
+  }
+
+  // 0xF002 AUDIO, 16 bytes of sample bits from I
+  OP(AUDIO): {
+    ReadMemory(I, audioPattern, sizeof(audioPattern));
+    NEXT();
+  }
+
+  // 0xFX3A PITCH Vx
+  OP(PITCH): {
+    pitch = V[ins->x];
+    NEXT();
+  }
+
+#ifndef CHIP8_COMPUTED_GOTO
   }
+#endif
+
+#undef FETCH
+#undef SKIP
+#undef OP
+#undef DISPATCH
+#undef NEXT
+#undef PROFILE
+#undef SPIN
 }
@@ -0,0 +1,469 @@
+#include "jit.hpp"
+#include "chip8.hpp"
+#include <algorithm>
+#include <cstring>
+#include <initializer_list>
+
+#ifdef CHIP8_JIT_X86_64
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifdef CHIP8_JIT_X86_64
+// Sets the protection of the pages holding [start, start + size) only;
+// blocks on the other pages stay executable while one is copied in
+void ProtectPages(uint8_t *start, size_t size, int protection) {
+  static const uintptr_t page = sysconf(_SC_PAGESIZE);
+  uintptr_t first = reinterpret_cast<uintptr_t>(start) & ~(page - 1);
+  uintptr_t end =
+      (reinterpret_cast<uintptr_t>(start) + size + page - 1) & ~(page - 1);
+  mprotect(reinterpret_cast<void *>(first), end - first, protection);
+}
+#endif
+
+// x86-64 encoder for the handful of instructions the JIT needs. Blocks are
+// called as uint32_t(uint8_t *V, uint16_t *I), so V is addressed off rdi,
+// I through rsi and the next pc goes back in eax (System V ABI); al and cl
+// are scratch.
+class Emitter {
+public:
+  std::vector<uint8_t> code;
+
+  void Emit(std::initializer_list<uint8_t> bytes) {
+    code.insert(code.end(), bytes);
+  }
+
+  // Register operand [rdi + idx], ModRM reg field in `reg`
+  void EmitV(uint8_t op, uint8_t reg, uint8_t idx) {
+    Emit({op, static_cast<uint8_t>(0x47 | (reg << 3)), idx});
+  }
+
+  void LoadAl(uint8_t idx) { EmitV(0x8A, 0, idx); }   // mov al, [V+idx]
+  void StoreAl(uint8_t idx) { EmitV(0x88, 0, idx); }  // mov [V+idx], al
+  void StoreCl(uint8_t idx) { EmitV(0x88, 1, idx); }  // mov [V+idx], cl
+
+  void StoreImm(uint8_t idx, uint8_t value) {         // mov byte [V+idx], imm
+    Emit({0xC6, 0x47, idx, value});
+  }
+
+  // Arithmetic result in al, flag in cl
+  void StoreResultAndFlag(uint8_t x) {
+    StoreAl(x);
+    StoreCl(0xF);
+  }
+
+  // mov eax, pc; ret
+  void ReturnPc(uint16_t pc) {
+    Emit({0xB8, static_cast<uint8_t>(pc & 0xFF), static_cast<uint8_t>(pc >> 8),
+          0x00, 0x00, 0xC3});
+  }
+
+  // After a compare: mov eax, next; mov ecx, taken; cmovcc eax, ecx; ret
+  void ReturnPcIf(uint8_t cmov, uint16_t taken, uint16_t next) {
+    Emit({0xB8, static_cast<uint8_t>(next & 0xFF),
+          static_cast<uint8_t>(next >> 8), 0x00, 0x00, 0xB9,
+          static_cast<uint8_t>(taken & 0xFF), static_cast<uint8_t>(taken >> 8),
+          0x00, 0x00, 0x0F, cmov, 0xC1, 0xC3});
+  }
+};
+
+constexpr uint8_t CMOVE = 0x44;
+constexpr uint8_t CMOVNE = 0x45;
+
+// Appends the translation of `opcode`, false if it has to be interpreted.
+// FX1E wraps I with `addressMask`.
+bool Translate(Emitter &e, uint16_t opcode, uint16_t addressMask,
+               const QuirkFlags &quirks) {
+  uint8_t x = (opcode & 0x0F00) >> 8;
+  uint8_t y = (opcode & 0x00F0) >> 4;
+  uint8_t nn = opcode & 0x00FF;
+  uint16_t nnn = opcode & 0x0FFF;
+
+  switch (opcode >> 12) {
+    // 6XNN LD Vx, byte
+    case (0x6): e.StoreImm(x, nn); return true;
+
+    // 7XNN ADD Vx, byte: add byte [V+x], imm
+    case (0x7): e.Emit({0x80, 0x47, x, nn}); return true;
+
+    case (0x8): {
+      switch (opcode & 0xF) {
+        case (0): e.LoadAl(y); e.StoreAl(x); return true;
+        // OR / AND / XOR [V+x], al, then VF <- 0 (VF reset quirk)
+        case (1): case (2): case (3): {
+          static const uint8_t ALU[] = {0x08, 0x20, 0x30};
+          e.LoadAl(y); e.EmitV(ALU[(opcode & 0xF) - 1], 0, x);
+          if (quirks.vfReset) e.StoreImm(0xF, 0);
+          return true;
+        }
+        // ADD: add al, [V+y]; setc cl
+        case (4): {
+          e.LoadAl(x); e.EmitV(0x02, 0, y); e.Emit({0x0F, 0x92, 0xC1});
+          e.StoreResultAndFlag(x);
+          return true;
+        }
+        // SUB: sub al, [V+y]; setnc cl (not borrow)
+        case (5): {
+          e.LoadAl(x); e.EmitV(0x2A, 0, y); e.Emit({0x0F, 0x93, 0xC1});
+          e.StoreResultAndFlag(x);
+          return true;
+        }
+        // SHR: mov cl, al; and cl, 1; shr al, 1
+        case (6): {
+          e.LoadAl(quirks.shiftVy ? y : x); e.Emit({0x88, 0xC1, 0x80, 0xE1, 0x01, 0xD0, 0xE8});
+          e.StoreResultAndFlag(x);
+          return true;
+        }
+        // SUBN: Vy - Vx
+        case (7): {
+          e.LoadAl(y); e.EmitV(0x2A, 0, x); e.Emit({0x0F, 0x93, 0xC1});
+          e.StoreResultAndFlag(x);
+          return true;
+        }
+        // SHL: mov cl, al; shr cl, 7; shl al, 1
+        case (0xE): {
+          e.LoadAl(quirks.shiftVy ? y : x); e.Emit({0x88, 0xC1, 0xC0, 0xE9, 0x07, 0xD0, 0xE0});
+          e.StoreResultAndFlag(x);
+          return true;
+        }
+      }
+      return false;
+    }
+
+    // ANNN LD I, addr: mov word [rsi], imm16
+    case (0xA): {
+      e.Emit({0x66, 0xC7, 0x06, static_cast<uint8_t>(nnn & 0xFF),
+              static_cast<uint8_t>(nnn >> 8)});
+      return true;
+    }
+
+    // FX1E ADD I, Vx: movzx eax, [V+x]; add ax, [rsi]; and ax, mask;
+    // mov [rsi], ax
+    case (0xF): {
+      if (nn != 0x1E) return false;
+      e.Emit({0x0F, 0xB6, 0x47, x, 0x66, 0x03, 0x06, 0x66, 0x25,
+              static_cast<uint8_t>(addressMask & 0xFF),
+              static_cast<uint8_t>(addressMask >> 8), 0x66, 0x89, 0x06});
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// Appends the jump or skip at `at` as the end of a block, false if it has
+// to be interpreted. A jump to itself is left to the interpreter, which
+// spins through it.
+bool TranslateBranch(Emitter &e, uint16_t opcode, uint16_t at,
+                     const uint8_t *memory, uint16_t addressMask,
+                     const QuirkFlags &quirks) {
+  uint8_t x = (opcode & 0x0F00) >> 8;
+  uint8_t y = (opcode & 0x00F0) >> 4;
+  uint8_t nn = opcode & 0x00FF;
+  uint16_t nnn = opcode & 0x0FFF;
+
+  // Taken skips step over F000 NNNN whole where the profile has it
+  uint16_t next = at + 2;
+  bool longSkip = quirks.longSkip && memory[next & addressMask] == 0xF0 &&
+                  memory[(next + 1) & addressMask] == 0x00;
+  uint16_t skipped = next + (longSkip ? 4 : 2);
+
+  switch (opcode >> 12) {
+    // 1NNN JP addr
+    case (0x1): {
+      if (nnn == at) return false;
+      e.ReturnPc(nnn);
+      return true;
+    }
+
+    // 3XNN / 4XNN SE / SNE Vx, byte: cmp byte [V+x], imm
+    case (0x3): case (0x4): {
+      e.Emit({0x80, 0x7F, x, nn});
+      e.ReturnPcIf(opcode >> 12 == 0x3 ? CMOVE : CMOVNE, skipped, next);
+      return true;
+    }
+
+    // 5XY0 / 9XY0 SE / SNE Vx, Vy: cmp [V+x], al
+    case (0x5): case (0x9): {
+      uint8_t n = opcode & 0xF;
+      if ((opcode >> 12) == 0x5 && (n == 2 || n == 3)) {
+        return false; // XO-CHIP register ranges
+      }
+      e.LoadAl(y); e.EmitV(0x38, 0, x);
+      e.ReturnPcIf(opcode >> 12 == 0x5 ? CMOVE : CMOVNE, skipped, next);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// Instructions after which there is no telling where execution goes
+bool EndsRun(uint16_t opcode) {
+  switch (opcode >> 12) {
+    case (0x0): return opcode == 0x00EE || opcode == 0x00FD;
+    case (0xB): return true;
+    case (0xF): return opcode == 0xF000 || (opcode & 0xFF) == 0x0A;
+  }
+  return false;
+}
+
+// Handing off to the interpreter and back costs about as much as running
+// ten instructions natively saves, so interpreted runs go on through
+// blocks shorter than this
+constexpr uint16_t MIN_BLOCK_BETWEEN_RUNS = 8;
+
+// Bytes a block depends on. Compiled code: its instructions and the one
+// after them, which either ended it or decides how far a taken skip goes.
+// Interpreted runs: the idle loop they may start; the interpreter reads the
+// rest itself, so a stale run only ends somewhere else.
+int BlockEnd(uint16_t start, uint16_t count, bool compiled) {
+  return std::min<int>(compiled ? start + 2 * count + 2 : start + 6,
+                       CHIP8::MEMORY_SIZE);
+}
+
+} // namespace
+
+bool Jit::IsSupported() {
+#ifdef CHIP8_JIT_X86_64
+  return true;
+#else
+  return false;
+#endif
+}
+
+Jit::Jit(CHIP8 *chip8)
+    : compiledBlocks(0), chip8(chip8), blocks(), covered(), coveredStart(0),
+      coveredEnd(0), arena(nullptr), arenaUsed(0) {
+#ifdef CHIP8_JIT_X86_64
+  void *mem = mmap(nullptr, ARENA_SIZE, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mem != MAP_FAILED) {
+    arena = static_cast<uint8_t *>(mem);
+  }
+#endif
+}
+
+Jit::~Jit() {
+#ifdef CHIP8_JIT_X86_64
+  if (arena) {
+    munmap(arena, ARENA_SIZE);
+  }
+#endif
+}
+
+void Jit::RunCycles(uint32_t cycles) {
+  Interpreter &cpu = chip8->interpreter;
+
+  while (cycles > 0) {
+    uint16_t pc = cpu.pc;
+
+    // Outside what blocks cover, e.g. XO-CHIP code above 4kb
+    if (!arena || pc < Interpreter::CACHE_START || pc >= CHIP8::MEMORY_SIZE) {
+      cpu.RunCycles(cycles);
+      return;
+    }
+
+    Block &block = blocks[pc].valid ? blocks[pc] : Compile(pc);
+
+    // Blocks only run whole, so cycle counts match the interpreter
+    if (block.code && block.count <= cycles) {
+      cpu.pc = block.code(cpu.V, &cpu.I);
+      cycles -= block.count;
+      continue;
+    }
+
+    uint32_t run = block.code ? cycles : HandOff(block, cycles);
+    cpu.RunCycles(run);
+    cycles -= run;
+  }
+}
+
+// Instructions to hand the interpreter at a block without code: its run,
+// or all of them when it is going to spin through them anyway
+uint32_t Jit::HandOff(const Block &block, uint32_t cycles) const {
+  const Interpreter &cpu = chip8->interpreter;
+  bool spins = false;
+
+  if (cpu.skipIdle) {
+    switch (block.idle) {
+      case IdleLoop::Jump: spins = true; break;
+      case IdleLoop::Key:
+        spins = true;
+        for (int key = 0; key < 16 && spins; key++) {
+          spins = !chip8->keypad.IsKeyDown(key);
+        }
+        break;
+      case IdleLoop::Timer: spins = cpu.delayTimer != 0; break;
+      case IdleLoop::None: break;
+    }
+  }
+  return spins ? cycles : std::min<uint32_t>(block.count, cycles);
+}
+
+Jit::Block &Jit::Compile(uint16_t start) {
+  Block &block = blocks[start];
+  block.code = nullptr;
+  block.count = 0;
+  block.idle = IdleLoop::None;
+  block.valid = true;
+
+  Emitter e;
+  QuirkFlags quirks = GetQuirkFlags(chip8->interpreter.quirks);
+  const uint8_t *memory = chip8->memory;
+  uint16_t addressMask = chip8->memorySize - 1;
+  uint16_t addr = start;
+  bool branched = false;
+  while (block.count < MAX_BLOCK && addr + 1 < CHIP8::MEMORY_SIZE) {
+    uint16_t opcode = memory[addr] << 8 | memory[addr + 1];
+    if (!Translate(e, opcode, addressMask, quirks)) {
+      branched = TranslateBranch(e, opcode, addr, memory, addressMask, quirks);
+      block.count += branched;
+      break;
+    }
+    block.count++;
+    addr += 2;
+  }
+
+  if (block.count == 0) {
+    // Interpreted run, along the way the interpreter most likely goes:
+    // through jumps, calls and their returns, and past skips. It ends at
+    // the next block worth leaving the interpreter for, or at an idle loop,
+    // which gets handed off on its own.
+    Emitter scratch;
+    uint16_t returns[16];
+    uint8_t depth = 0;
+    do {
+      uint16_t opcode = memory[addr] << 8 | memory[addr + 1];
+      block.count++;
+      if ((opcode >> 12) == 0x1) {
+        addr = opcode & 0x0FFF;
+      } else if ((opcode >> 12) == 0x2) {
+        if (depth < 16) {
+          returns[depth++] = addr + 2;
+        }
+        addr = opcode & 0x0FFF;
+      } else if (opcode == 0x00EE && depth > 0) {
+        addr = returns[--depth];
+      } else if (EndsRun(opcode)) {
+        break;
+      } else {
+        addr += 2;
+      }
+      uint16_t length = 0;
+      scratch.code.clear();
+      for (uint16_t at = addr; length < MIN_BLOCK_BETWEEN_RUNS &&
+                               at + 1 < CHIP8::MEMORY_SIZE; at += 2) {
+        opcode = memory[at] << 8 | memory[at + 1];
+        if (!Translate(scratch, opcode, addressMask, quirks)) {
+          length += TranslateBranch(scratch, opcode, at, memory, addressMask,
+                                    quirks);
+          break;
+        }
+        length++;
+      }
+      if (length >= MIN_BLOCK_BETWEEN_RUNS ||
+          IdleLoopAt(memory, addr) != IdleLoop::None) {
+        break;
+      }
+    } while (block.count < MAX_RUN && addr + 1 < CHIP8::MEMORY_SIZE);
+
+    block.idle = IdleLoopAt(memory, start);
+  } else {
+    // Straight-line blocks continue at the instruction that ended them
+    if (!branched) {
+      e.ReturnPc(addr);
+    }
+
+#ifdef CHIP8_JIT_X86_64
+    if (arenaUsed + e.code.size() > ARENA_SIZE) {
+      Flush();
+      return Compile(start);
+    }
+
+    uint8_t *dest = arena + arenaUsed;
+    ProtectPages(dest, e.code.size(), PROT_READ | PROT_WRITE);
+    memcpy(dest, e.code.data(), e.code.size());
+    ProtectPages(dest, e.code.size(), PROT_READ | PROT_EXEC);
+    arenaUsed += e.code.size();
+
+    block.code = reinterpret_cast<BlockFn>(dest);
+    compiledBlocks++;
+#endif
+  }
+
+  int end = BlockEnd(start, block.count, block.code != nullptr);
+  for (int a = start; a < end; a++) {
+    covered[a]++;
+  }
+  if (coveredStart == coveredEnd) {
+    coveredStart = start;
+    coveredEnd = end;
+  } else {
+    coveredStart = std::min<int>(coveredStart, start);
+    coveredEnd = std::max(coveredEnd, end);
+  }
+  live.push_back(start);
+  return block;
+}
+
+// Loop starting at `at` that Interpreter::skipIdle recognizes; it checks
+// again before spinning
+Jit::IdleLoop Jit::IdleLoopAt(const uint8_t *memory, uint16_t at) {
+  uint16_t opcode = memory[at] << 8 | memory[at + 1];
+  uint8_t x = (opcode & 0x0F00) >> 8;
+
+  if (opcode == (0x1000 | at)) {
+    return IdleLoop::Jump;
+  }
+  if ((opcode & 0xF0FF) == 0xF00A) {
+    return IdleLoop::Key;
+  }
+  if ((opcode & 0xF0FF) == 0xF007 && at + 6 <= CHIP8::MEMORY_SIZE &&
+      memory[at + 2] == (0x30 | x) && memory[at + 3] == 0x00 &&
+      (memory[at + 4] << 8 | memory[at + 5]) == (0x1000 | at)) {
+    return IdleLoop::Timer;
+  }
+  return IdleLoop::None;
+}
+
+void Jit::Drop(uint16_t address, uint16_t length) {
+  int last = std::min<int>(address + length, CHIP8::MEMORY_SIZE);
+
+  bool hit = false;
+  for (int a = address; a < last && !hit; a++) {
+    hit = covered[a] != 0;
+  }
+  if (!hit) {
+    return;
+  }
+
+  for (size_t i = 0; i < live.size();) {
+    uint16_t start = live[i];
+    Block &block = blocks[start];
+    int end = BlockEnd(start, block.count, block.code != nullptr);
+
+    if (start < last && end > address) {
+      for (int a = start; a < end; a++) {
+        covered[a]--;
+      }
+      block.valid = false;
+      live[i] = live.back();
+      live.pop_back();
+    } else {
+      i++;
+    }
+  }
+}
+
+void Jit::Flush() {
+  for (uint16_t start : live) {
+    blocks[start].valid = false;
+  }
+  live.clear();
+  memset(covered, 0, sizeof(covered));
+  coveredStart = coveredEnd = 0;
+  arenaUsed = 0;
+}
@@ -1,16 +1,138 @@
 #include "chip8.hpp"
+#include "sdl_audio.hpp"
+#include "sdl_input.hpp"
+#include "sdl_video.hpp"
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <random>
+#include <string>
+
+static void PrintUsage(const char *program) {
+  std::cout << "Usage: " << program << " [options] [filename]\n"
+            << "   --jit      Run with the x86-64 recompiler\n"
+            << "   --ipf N    Instructions per 60 Hz frame (default "
+            << CHIP8::CYCLES_PER_FRAME << ")\n"
+            << "   --turbo    Run as fast as possible\n"
+            << "   --vsync    Present in step with the display refresh\n"
+            << "   --ff N     Fast-forward speed toggled with Tab (default "
+            << CHIP8::FAST_FORWARD_SPEED << "x)\n"
+            << "   --seed N   RND seed (default: random, printed at start)\n"
+            << "   --xochip   64kb of memory even for small ROMs\n"
+            << "   --quirks NAME  vip (default), schip or xochip behavior\n"
+            << "   --telemetry  Key to display latency and frame times in the\n"
+            << "                title bar and at exit\n"
+            << "   --profile FILE  Where F8 and exit write the profile (JSON if\n"
+            << "                   FILE ends in .json, folded stacks otherwise;\n"
+            << "                   needs a build with make PROFILE=1)\n";
+}
+
+// Positive integer option value, 0 if invalid
+static unsigned long ParseCount(const char *value) {
+  char *end;
+  unsigned long count = strtoul(value, &end, 10);
+  return (*value != '\0' && *end == '\0') ? count : 0;
+}
 
 int main(int argc, char **argv) {
-  if (argc != 2) {
-    std::cout << "Too few arguments to run CHIP-8 emulador\n"
-      << "   Usage: " << argv[0] << " [filename]\n";
+  const char *filename = nullptr;
+  bool useJit = false;
+  bool turbo = false;
+  bool vsync = false;
+  bool telemetry = false;
+  bool xochip = false;
+  QuirkProfile quirks = QuirkProfile::CosmacVip;
+  unsigned long ipf = CHIP8::CYCLES_PER_FRAME;
+  unsigned long fastForwardSpeed = CHIP8::FAST_FORWARD_SPEED;
+  bool hasSeed = false;
+  uint64_t seed = 0;
+  std::string profileFile = "chip8_profile.json";
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--jit") == 0) {
+      useJit = true;
+    } else if (strcmp(argv[i], "--turbo") == 0) {
+      turbo = true;
+    } else if (strcmp(argv[i], "--vsync") == 0) {
+      vsync = true;
+    } else if (strcmp(argv[i], "--telemetry") == 0) {
+      telemetry = true;
+    } else if (strcmp(argv[i], "--xochip") == 0) {
+      xochip = true;
+    } else if (strcmp(argv[i], "--ipf") == 0 && i + 1 < argc) {
+      ipf = ParseCount(argv[++i]);
+      if (ipf == 0) {
+        std::cout << "--ipf expects a positive number\n";
+        return 0;
+      }
+    } else if (strcmp(argv[i], "--ff") == 0 && i + 1 < argc) {
+      fastForwardSpeed = ParseCount(argv[++i]);
+      if (fastForwardSpeed == 0) {
+        std::cout << "--ff expects a positive number\n";
+        return 0;
+      }
+    } else if (strcmp(argv[i], "--quirks") == 0 && i + 1 < argc) {
+      if (!ParseQuirkProfile(argv[++i], quirks)) {
+        std::cout << "--quirks expects vip, schip or xochip\n";
+        return 0;
+      }
+    } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      seed = strtoull(argv[++i], nullptr, 10);
+      hasSeed = true;
+    } else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+      profileFile = argv[++i];
+      if (!PROFILING) {
+        std::cout << "Built without profiling, rebuild with make PROFILE=1\n";
+      }
+    } else if (argv[i][0] == '-') {
+      std::cout << "Unknown option " << argv[i] << "\n";
+      PrintUsage(argv[0]);
+      return 0;
+    } else {
+      filename = argv[i];
+    }
+  }
+
+  if (filename == nullptr) {
+    std::cout << "Too few arguments to run CHIP-8 emulador\n";
+    PrintUsage(argv[0]);
     return 0;
   }
 
   CHIP8 chip8;
+  chip8.instructionsPerFrame = ipf;
+  chip8.turbo = turbo;
+  chip8.fastForwardSpeed = fastForwardSpeed;
+  chip8.SetQuirks(quirks);
+  if (xochip) {
+    chip8.SetMemorySize(CHIP8::MAX_MEMORY_SIZE);
+  }
+
+  // A fresh seed per session, printed so the session can be replayed
+  if (!hasSeed) {
+    std::random_device device;
+    seed = (static_cast<uint64_t>(device()) << 32) | device();
+    std::cout << "Seed: " << seed << "\n";
+  }
+  chip8.interpreter.rng.Seed(seed);
+
+  if (useJit && !chip8.UseJit(true)) {
+    std::cout << "JIT is not supported on this platform, interpreting\n";
+  }
+
+  chip8.stateFile = std::string(filename) + ".state";
+  chip8.profileFile = profileFile;
+  if (telemetry) {
+    chip8.telemetry.reset(new Telemetry);
+  }
+
+  if (chip8.ReadRom(filename)) {
+    // SDL frontend, destroyed in reverse order (SDL_Quit last)
+    SDLVideo video(vsync);
+    SDLAudio audio;
+    SDLInput input(chip8.keypad);
 
-  if (chip8.ReadRom(argv[1])) {
+    chip8.AttachBackends(&video, &audio, &input);
     chip8.Run();
   }
 
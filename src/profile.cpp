@@ -0,0 +1,129 @@
+#include "profile.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char *const OP_NAMES[OP_COUNT] = {
+#define CHIP8_OP_NAME(name) #name,
+    CHIP8_OPS(CHIP8_OP_NAME)
+#undef CHIP8_OP_NAME
+};
+
+std::string Hex(uint16_t value) {
+  char text[8];
+  snprintf(text, sizeof(text), "0x%03X", value);
+  return text;
+}
+
+// Handler name of the instruction currently stored at address
+const char *OpNameAt(const uint8_t *memory, uint16_t address) {
+  uint16_t opcode = memory[address] << 8 | memory[(address + 1) & 0xFFFF];
+  return OP_NAMES[Interpreter::Decode(opcode).op];
+}
+
+// Executed addresses, most executed first
+std::vector<uint16_t> HotAddresses(const uint64_t *pcCounts) {
+  std::vector<uint16_t> addresses;
+  for (uint32_t pc = 0; pc < 0x10000; pc++) {
+    if (pcCounts[pc] != 0) {
+      addresses.push_back(pc);
+    }
+  }
+  std::stable_sort(addresses.begin(), addresses.end(),
+                   [pcCounts](uint16_t a, uint16_t b) {
+                     return pcCounts[a] > pcCounts[b];
+                   });
+  return addresses;
+}
+
+} // namespace
+
+Profile::Profile() {
+  Reset();
+}
+
+void Profile::Reset() {
+  memset(opCounts, 0, sizeof(opCounts));
+  memset(pcCounts, 0, sizeof(pcCounts));
+  memset(pcFunction, 0, sizeof(pcFunction));
+  draws = 0;
+  memoryWrites = 0;
+  callStack[0] = 0x200;
+  depth = 0;
+}
+
+void Profile::Call(uint16_t target) {
+  if (depth < 16) {
+    callStack[++depth] = target;
+  }
+}
+
+void Profile::Return() {
+  if (depth > 0) {
+    depth--;
+  }
+}
+
+void Profile::WriteJson(std::ostream &out, const uint8_t *memory) const {
+  uint64_t instructions = 0;
+  for (int op = 0; op < OP_COUNT; op++) {
+    instructions += op == OP_DECODE ? 0 : opCounts[op];
+  }
+
+  out << "{\n  \"instructions\": " << instructions
+      << ",\n  \"decode_misses\": " << opCounts[OP_DECODE]
+      << ",\n  \"draws\": " << draws
+      << ",\n  \"memory_writes\": " << memoryWrites << ",\n  \"ops\": {";
+
+  bool first = true;
+  for (int op = 0; op < OP_COUNT; op++) {
+    if (op != OP_DECODE && opCounts[op] != 0) {
+      out << (first ? "\n" : ",\n") << "    \"" << OP_NAMES[op]
+          << "\": " << opCounts[op];
+      first = false;
+    }
+  }
+
+  out << "\n  },\n  \"hot_addresses\": [";
+  first = true;
+  for (uint16_t pc : HotAddresses(pcCounts)) {
+    out << (first ? "\n" : ",\n") << "    {\"pc\": \"" << Hex(pc)
+        << "\", \"function\": \"" << Hex(pcFunction[pc])
+        << "\", \"op\": \"" << OpNameAt(memory, pc)
+        << "\", \"count\": " << pcCounts[pc] << "}";
+    first = false;
+  }
+  out << "\n  ]\n}\n";
+}
+
+void Profile::WriteFolded(std::ostream &out, const uint8_t *memory) const {
+  for (uint32_t pc = 0; pc < 0x10000; pc++) {
+    if (pcCounts[pc] != 0) {
+      out << "sub_" << Hex(pcFunction[pc]) << ";" << Hex(pc) << ":"
+          << OpNameAt(memory, pc) << " " << pcCounts[pc] << "\n";
+    }
+  }
+}
+
+bool Profile::WriteFile(const char *filename, const uint8_t *memory) const {
+  std::ofstream file(filename);
+
+  if (!file) {
+    std::cout << "Error while opening the profile file\n";
+    return false;
+  }
+
+  std::string name(filename);
+  if (name.size() >= 5 && name.compare(name.size() - 5, 5, ".json") == 0) {
+    WriteJson(file, memory);
+  } else {
+    WriteFolded(file, memory);
+  }
+  return true;
+}
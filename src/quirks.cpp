@@ -0,0 +1,38 @@
+#include "quirks.hpp"
+#include <cstring>
+
+namespace {
+
+template <class Quirks> constexpr QuirkFlags FlagsOf() {
+  return {Quirks::VF_RESET, Quirks::SHIFT_VY, Quirks::INCREMENT_I,
+          Quirks::JUMP_VX, Quirks::WRAP_SPRITES, Quirks::LONG_SKIP};
+}
+
+const char *const NAMES[] = {"vip", "schip", "xochip"};
+
+} // namespace
+
+QuirkFlags GetQuirkFlags(QuirkProfile profile) {
+  switch (profile) {
+  case QuirkProfile::SuperChip:
+    return FlagsOf<SuperChipQuirks>();
+  case QuirkProfile::XoChip:
+    return FlagsOf<XoChipQuirks>();
+  default:
+    return FlagsOf<CosmacVipQuirks>();
+  }
+}
+
+const char *QuirkProfileName(QuirkProfile profile) {
+  return NAMES[static_cast<int>(profile)];
+}
+
+bool ParseQuirkProfile(const char *name, QuirkProfile &profile) {
+  for (int i = 0; i < 3; i++) {
+    if (strcmp(name, NAMES[i]) == 0) {
+      profile = static_cast<QuirkProfile>(i);
+      return true;
+    }
+  }
+  return false;
+}
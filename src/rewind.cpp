@@ -0,0 +1,176 @@
+#include "rewind.hpp"
+#include "chip8.hpp"
+#include <cstring>
+#include <type_traits>
+
+// States are diffed as raw words
+static_assert(std::is_trivially_copyable<MachineState>::value,
+              "MachineState must be trivially copyable");
+static_assert(offsetof(MachineState, memory) % 8 == 0,
+              "MachineState must be a whole number of words");
+static_assert(sizeof(MachineState) / 8 <= 0xFFFF, "Run lengths are 16 bits");
+
+namespace {
+
+const uint64_t *Words(const MachineState &state) {
+  return reinterpret_cast<const uint64_t *>(&state);
+}
+
+void PutRun(std::vector<uint8_t> &out, uint16_t length) {
+  out.push_back(length & 0xFF);
+  out.push_back(length >> 8);
+}
+
+uint16_t GetRun(const uint8_t *in) {
+  return in[0] | in[1] << 8;
+}
+
+} // namespace
+
+Rewind::Rewind() : newest(0), segmentCount(0) {}
+
+void Rewind::Capture(const CHIP8 &chip8) {
+  if (segments.empty()) {
+    segments.resize(SEGMENTS);
+  }
+
+  Segment *segment = segmentCount ? &segments[newest] : nullptr;
+
+  if (!segment || segment->frames == KEYFRAME_INTERVAL) {
+    chip8.CaptureState(scratch);
+    NewSegment(scratch);
+    return;
+  }
+
+  chip8.CaptureState(scratch);
+  if (scratch.UsedBytes() != segment->keyframe.size()) {
+    NewSegment(scratch); // Memory size changed, deltas would not line up
+    return;
+  }
+
+  uint32_t index = segment->frames - 1;
+  if (segment->deltas.size() <= index) {
+    segment->deltas.resize(index + 1);
+  }
+  std::vector<uint8_t> &delta = segment->deltas[index];
+  Encode(segment->keyframe, scratch, delta);
+
+  // Past this size (e.g. after the RNG refilled its state) a fresh
+  // keyframe is cheaper than carrying large deltas until the next one
+  if (delta.size() > segment->keyframe.size() / MAX_DELTA_DIVISOR) {
+    NewSegment(scratch);
+    return;
+  }
+  segment->frames++;
+}
+
+void Rewind::NewSegment(const MachineState &keyframe) {
+  // Overwrites the oldest segment when the ring is full
+  newest = segmentCount ? (newest + 1) % SEGMENTS : 0;
+  if (segmentCount < SEGMENTS) {
+    segmentCount++;
+  }
+  Segment &segment = segments[newest];
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&keyframe);
+  segment.keyframe.assign(bytes, bytes + keyframe.UsedBytes());
+  segment.frames = 1;
+}
+
+bool Rewind::StepBack(CHIP8 &chip8) {
+  if (FramesStored() < 2) {
+    return false;
+  }
+
+  Segment *segment = &segments[newest];
+  if (--segment->frames == 0) {
+    newest = (newest + SEGMENTS - 1) % SEGMENTS;
+    segmentCount--;
+    segment = &segments[newest];
+  }
+
+  if (segment->frames == 1) {
+    memcpy(&scratch, segment->keyframe.data(), segment->keyframe.size());
+  } else {
+    Decode(segment->keyframe, segment->deltas[segment->frames - 2], scratch);
+  }
+  chip8.RestoreState(scratch);
+  return true;
+}
+
+void Rewind::Clear() {
+  newest = 0;
+  segmentCount = 0;
+}
+
+uint32_t Rewind::FramesStored() const {
+  uint32_t frames = 0;
+  for (uint32_t i = 0; i < segmentCount; i++) {
+    frames += segments[(newest + SEGMENTS - i) % SEGMENTS].frames;
+  }
+  return frames;
+}
+
+size_t Rewind::BytesUsed() const {
+  size_t bytes = segments.size() * sizeof(Segment);
+  for (const Segment &segment : segments) {
+    bytes += segment.keyframe.capacity();
+    for (const std::vector<uint8_t> &delta : segment.deltas) {
+      bytes += delta.capacity();
+    }
+  }
+  return bytes;
+}
+
+// Delta layout: pairs of little-endian word counts (unchanged, changed)
+// followed by the changed words XORed with the keyframe
+void Rewind::Encode(const std::vector<uint8_t> &keyframe,
+                    const MachineState &state, std::vector<uint8_t> &out) {
+  const uint64_t *base = reinterpret_cast<const uint64_t *>(keyframe.data());
+  const uint64_t *words = Words(state);
+  const size_t stateWords = keyframe.size() / 8;
+  out.clear();
+
+  size_t i = 0;
+  while (i < stateWords) {
+    size_t same = i;
+    while (same < stateWords && words[same] == base[same]) {
+      same++;
+    }
+    size_t changed = same;
+    while (changed < stateWords && words[changed] != base[changed]) {
+      changed++;
+    }
+    if (same == stateWords) {
+      break; // Trailing unchanged words are implied
+    }
+
+    PutRun(out, same - i);
+    PutRun(out, changed - same);
+    for (size_t w = same; w < changed; w++) {
+      uint64_t diff = words[w] ^ base[w];
+      const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&diff);
+      out.insert(out.end(), bytes, bytes + 8);
+    }
+    i = changed;
+  }
+}
+
+void Rewind::Decode(const std::vector<uint8_t> &keyframe,
+                    const std::vector<uint8_t> &in, MachineState &state) {
+  memcpy(&state, keyframe.data(), keyframe.size());
+  uint64_t *words = reinterpret_cast<uint64_t *>(&state);
+
+  size_t w = 0;
+  const uint8_t *p = in.data();
+  const uint8_t *end = p + in.size();
+  while (p < end) {
+    w += GetRun(p);
+    uint16_t changed = GetRun(p + 2);
+    p += 4;
+    for (uint16_t k = 0; k < changed; k++, w++, p += 8) {
+      uint64_t diff;
+      memcpy(&diff, p, 8);
+      words[w] ^= diff;
+    }
+  }
+}
@@ -0,0 +1,112 @@
+#include "save_state.hpp"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+template <typename T> void Put(std::ostream &out, const T &value) {
+  out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template <typename T> void Get(std::istream &in, T &value) {
+  in.read(reinterpret_cast<char *>(&value), sizeof(value));
+}
+
+} // namespace
+
+bool WriteState(const MachineState &state, const char *filename) {
+  std::ofstream file(filename, std::ios::out | std::ios::binary);
+
+  if (!file) {
+    std::cerr << "Error while opening the state file\n";
+    return false;
+  }
+
+  Put(file, MachineState::MAGIC);
+  Put(file, MachineState::VERSION);
+
+  Put(file, state.memorySize);
+  Put(file, state.V);
+  Put(file, state.I);
+  Put(file, state.delayTimer);
+  Put(file, state.soundTimer);
+  Put(file, state.pc);
+  Put(file, state.stack);
+  Put(file, state.sp);
+  Put(file, state.framebuffer);
+  Put(file, state.hires);
+  Put(file, state.planeMask);
+  Put(file, state.cycleCount);
+  Put(file, state.frameCount);
+  Put(file, state.rng);
+  Put(file, state.flags);
+  Put(file, state.audioPattern);
+  Put(file, state.pitch);
+  file.write(reinterpret_cast<const char *>(state.memory), state.memorySize);
+
+  if (!file) {
+    std::cerr << "Error while writing the state file\n";
+    return false;
+  }
+
+  return true;
+}
+
+bool ReadState(MachineState &state, const char *filename) {
+  std::ifstream file(filename, std::ios::in | std::ios::binary);
+
+  if (!file) {
+    std::cerr << "Error while opening the state file\n";
+    return false;
+  }
+
+  uint32_t magic = 0;
+  uint16_t version = 0;
+  Get(file, magic);
+  Get(file, version);
+
+  if (magic != MachineState::MAGIC || version != MachineState::VERSION) {
+    std::cerr << "Not a CHIP-8 state file, or from another version\n";
+    return false;
+  }
+
+  // Read into a copy, a truncated file must not leave a half loaded state
+  MachineState loaded;
+  Get(file, loaded.memorySize);
+  Get(file, loaded.V);
+  Get(file, loaded.I);
+  Get(file, loaded.delayTimer);
+  Get(file, loaded.soundTimer);
+  Get(file, loaded.pc);
+  Get(file, loaded.stack);
+  Get(file, loaded.sp);
+  Get(file, loaded.framebuffer);
+  Get(file, loaded.hires);
+  Get(file, loaded.planeMask);
+  Get(file, loaded.cycleCount);
+  Get(file, loaded.frameCount);
+  Get(file, loaded.rng);
+  Get(file, loaded.flags);
+  Get(file, loaded.audioPattern);
+  Get(file, loaded.pitch);
+
+  bool knownSize = loaded.memorySize == 0x1000 || loaded.memorySize == 0x10000;
+  if (file && knownSize) {
+    file.read(reinterpret_cast<char *>(loaded.memory), loaded.memorySize);
+  }
+
+  if (!file) {
+    std::cerr << "Error while reading the state file\n";
+    return false;
+  }
+
+  if (!knownSize || loaded.sp > 16 || loaded.pc > loaded.memorySize ||
+      loaded.hires > 1 || loaded.planeMask > 3) {
+    std::cerr << "Corrupted state file\n";
+    return false;
+  }
+
+  memcpy(&state, &loaded, loaded.UsedBytes());
+  return true;
+}
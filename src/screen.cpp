@@ -1,119 +1,244 @@
 #include "screen.hpp"
 #include "chip8.hpp"
-#include <iostream>
-
+#include <algorithm>
 #include <cstring>
 
-const int Screen::SPRITE_WIDTH = 8;
-const int Screen::X_TILES = 64;
-const int Screen::Y_TILES = 32;
-const int Screen::WIN_WIDTH = X_TILES * 15;
-const int Screen::WIN_HEIGHT = Y_TILES * 15;
+namespace {
+
+// XORs `count` sprite lines `width` (8 or 16) pixels wide into rows of one
+// or two words. Lines start at column x; what passes the right edge is
+// lost, or enters at the left edge with Wrap. True on collision.
+template <bool Wrap>
+bool DrawLines(uint64_t *rows, int rowWords, int x, int count, int width,
+               const uint8_t *sprite) {
+  uint64_t collision = 0;
+
+  for (int i = 0; i < count; i++) {
+    uint64_t bits = width == 16 ? (sprite[2 * i] << 8 | sprite[2 * i + 1])
+                                : sprite[i];
+    // The line at the left edge of a word
+    uint64_t line = bits << (64 - width);
+    uint64_t *row = rows + i * rowWords;
+
+    if (rowWords == 1) {
+      uint64_t word = line >> x;
+      if (Wrap && x) {
+        word |= line << (64 - x);
+      }
+      collision |= row[0] & word;
+      row[0] ^= word;
+    } else {
+      uint64_t left = x < 64 ? line >> x : 0;
+      uint64_t right = x < 64 ? (x ? line << (64 - x) : 0) : line >> (x - 64);
+      if (Wrap && x > 64) {
+        left = line << (128 - x);
+      }
+      collision |= (row[0] & left) | (row[1] & right);
+      row[0] ^= left;
+      row[1] ^= right;
+    }
+  }
+
+  return collision != 0;
+}
+
+} // namespace
 
-Screen::Screen(CHIP8 *chip8)
-    : window(nullptr), renderer(nullptr), chip8(chip8) {
+Screen::Screen(CHIP8 *chip8) : chip8(chip8), hires(false), planeMask(1) {
+  memset(buffer2, 0, sizeof(buffer2));
   Clear();
 }
 
-Screen::~Screen() {
-  if (renderer) {
-    SDL_DestroyRenderer(renderer);
-    renderer = nullptr;
-  }
-  if (window) {
-    SDL_DestroyWindow(window);
-    window = nullptr;
+void Screen::Clear() {
+  for (int plane = 0; plane < PLANES; plane++) {
+    if (planeMask >> plane & 1) {
+      memset(Plane(plane), 0, sizeof(buffer));
+    }
   }
+  dirty = true;
+}
 
-  SDL_Quit();
-
-  std::cout << "Screen was destroyed" << std::endl;
+void Screen::SetHires(bool enable) {
+  hires = enable;
+  memset(buffer, 0, sizeof(buffer));
+  memset(buffer2, 0, sizeof(buffer2));
+  dirty = true;
 }
 
-void Screen::Clear() {
-  memset(buffer, false, X_TILES * Y_TILES);
+int Screen::GetColor(int x, int y) const {
+  int index = y * RowWords() + x / 64;
+  int shift = 63 - x % 64;
+  return (buffer[index] >> shift & 1) | (buffer2[index] >> shift & 1) << 1;
 }
 
-void Screen::InitSDL() {
-  if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) != 0) {
-    std::cerr << "Error initializing SDL: " << SDL_GetError() << std::endl;
-    exit(EXIT_FAILURE);
-  }
+uint64_t Screen::Hash() const {
+  uint64_t hash = 0xCBF29CE484222325ULL;
+  auto add = [&hash](uint64_t word) {
+    for (int byte = 0; byte < 8; byte++) {
+      hash ^= (word >> (8 * byte)) & 0xFF;
+      hash *= 0x100000001B3ULL;
+    }
+  };
 
-  window = SDL_CreateWindow("CHIP-8 Emulator", SDL_WINDOWPOS_CENTERED,
-                            SDL_WINDOWPOS_CENTERED, WIN_WIDTH, WIN_HEIGHT, 0);
-  if (window == nullptr) {
-    std::cerr << "Error creating window: " << SDL_GetError() << std::endl;
-    exit(EXIT_FAILURE);
+  int words = Height() * RowWords();
+  for (int i = 0; i < words; i++) {
+    add(buffer[i]);
   }
-
-  renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_SOFTWARE);
-  if (renderer == nullptr) {
-    std::cerr << "Error creating renderer: " << SDL_GetError() << std::endl;
-    exit(EXIT_FAILURE);
+  // Plane 2 and the mode only count once used, so plain CHIP-8 hashes
+  // stay what they were
+  if (hires || std::any_of(buffer2, buffer2 + words,
+                           [](uint64_t word) { return word != 0; })) {
+    add(hires);
+    for (int i = 0; i < words; i++) {
+      add(buffer2[i]);
+    }
   }
+  return hash;
 }
 
-void Screen::drawSprite(uint8_t x, uint8_t y, uint8_t spriteHeight,
-                        uint8_t *sprite) {
+void Screen::Render(uint32_t *pixels, int pitch,
+                    const uint32_t palette[4]) const {
+  int width = Width(), words = RowWords();
 
-  y %= Y_TILES;
- 
-  uint8_t maxHeight = std::min<uint8_t>(spriteHeight, Y_TILES - y);
-  uint8_t maxWidth = std::min<uint8_t>(SPRITE_WIDTH, X_TILES - x);
-
-  for (uint8_t i = 0; i < spriteHeight; i++) {
-    // Checking if the line has pixels outside screen
-    uint8_t partiallyOutOfRightSide = ((0xFF >> maxWidth) & sprite[i]);
-    bool partiallyOutOfBottom = (i > maxHeight) && (sprite[i] != 0);
-    if (partiallyOutOfRightSide || partiallyOutOfBottom) {
-      return;
+  for (int y = 0; y < Height(); y++) {
+    uint32_t *pixel = reinterpret_cast<uint32_t *>(
+        reinterpret_cast<uint8_t *>(pixels) + y * pitch);
+
+    for (int x = 0; x < width; x++) {
+      int index = y * words + x / 64;
+      int shift = 63 - x % 64;
+      pixel[x] = palette[(buffer[index] >> shift & 1) |
+                         (buffer2[index] >> shift & 1) << 1];
     }
   }
+}
 
-  for (uint8_t i = 0; i < maxHeight; i++) {
-    uint8_t spriteLine = sprite[i];
-
-    int destY = (y + i); // Y where the line will be draw
+bool Screen::DrawRows(uint64_t *rows, uint8_t x, uint8_t y,
+                      uint8_t spriteHeight, const uint8_t *sprite) {
+  // The starting position wraps around, the sprite itself is clipped
+  x %= X_TILES;
+  y %= Y_TILES;
 
-    for (uint8_t j = 0; j < maxWidth; j++) {
-      uint8_t destXforPixel = (x + j) % X_TILES; // X position of the j pixel
-      uint16_t idxInBuffer = destXforPixel + (destY * X_TILES);
+  int maxHeight = std::min<int>(spriteHeight, Y_TILES - y);
+  return DrawLines<false>(rows + y, 1, x, maxHeight, SPRITE_WIDTH, sprite);
+}
 
-      bool newPixelValue =
-          (buffer[idxInBuffer] ^ ((spriteLine >> (7 - j)) & 1));
+int Screen::SpriteBytes(uint8_t spriteHeight) const {
+  int perPlane = spriteHeight == 0 ? 32 : spriteHeight;
+  int planes = (planeMask & 1) + (planeMask >> 1 & 1);
+  return perPlane * planes;
+}
 
-      // Collision of pixels
-      if (buffer[idxInBuffer] && !newPixelValue) {
-        chip8->interpreter.V[0xF] = 1;
+template <bool Wrap>
+void Screen::drawSprite(uint8_t x, uint8_t y, uint8_t spriteHeight,
+                        const uint8_t *sprite) {
+  dirty = true;
+
+  // The starting position wraps around, the sprite itself is clipped
+  // unless Wrap continues it at the top
+  int width = spriteHeight == 0 ? 16 : SPRITE_WIDTH;
+  int lines = spriteHeight == 0 ? 16 : spriteHeight;
+  int left = x % Width();
+  int top = y % Height();
+  int count = std::min(lines, Height() - top);
+  int words = RowWords();
+  int lineBytes = width / 8;
+
+  bool collision = false;
+  for (int plane = 0; plane < PLANES; plane++) {
+    if (planeMask >> plane & 1) {
+      uint64_t *rows = Plane(plane);
+      collision |= DrawLines<Wrap>(rows + top * words, words, left, count,
+                                   width, sprite);
+      if (Wrap && count < lines) {
+        collision |= DrawLines<Wrap>(rows, words, left, lines - count, width,
+                                     sprite + count * lineBytes);
       }
-      buffer[idxInBuffer] = newPixelValue;
+      sprite += lines * lineBytes;
+    }
+  }
+
+  // Collision of pixels
+  if (collision) {
+    chip8->interpreter.V[0xF] = 1;
+  }
+}
+
+template void Screen::drawSprite<false>(uint8_t, uint8_t, uint8_t,
+                                        const uint8_t *);
+template void Screen::drawSprite<true>(uint8_t, uint8_t, uint8_t,
+                                       const uint8_t *);
+
+void Screen::ScrollDown(int lines) {
+  int words = RowWords();
+  lines = std::min(lines, Height());
+
+  for (int plane = 0; plane < PLANES; plane++) {
+    if (planeMask >> plane & 1) {
+      uint64_t *rows = Plane(plane);
+      memmove(rows + lines * words, rows,
+              (Height() - lines) * words * sizeof(uint64_t));
+      memset(rows, 0, lines * words * sizeof(uint64_t));
     }
   }
+  dirty = true;
 }
 
-void Screen::Render() {
-  // Clears screen with black
-  SDL_SetRenderDrawColor(renderer, 15, 15, 40, 255);
-  SDL_RenderClear(renderer);
-
-  // Rect used to draw "pixels"
-  SDL_Rect rect = {0, 0, WIN_WIDTH / X_TILES, WIN_HEIGHT / Y_TILES};
-
-  // For each pixel
-  for (uint16_t pixel = 0; pixel < X_TILES * Y_TILES; pixel++) {
-    // Coordinates in 64x32 grid
-    int y = pixel / X_TILES;
-    int x = pixel % X_TILES;
-    
-    // Paint if true
-    if (buffer[pixel]) {
-      rect.x = x * WIN_WIDTH / X_TILES; 
-      rect.y = y * WIN_HEIGHT / Y_TILES; 
-      SDL_SetRenderDrawColor(renderer, 0, 255, 102, 255);
-      SDL_RenderFillRect(renderer, &rect);
+void Screen::ScrollUp(int lines) {
+  int words = RowWords();
+  lines = std::min(lines, Height());
+
+  for (int plane = 0; plane < PLANES; plane++) {
+    if (planeMask >> plane & 1) {
+      uint64_t *rows = Plane(plane);
+      memmove(rows, rows + lines * words,
+              (Height() - lines) * words * sizeof(uint64_t));
+      memset(rows + (Height() - lines) * words, 0,
+             lines * words * sizeof(uint64_t));
     }
   }
+  dirty = true;
+}
 
-  SDL_RenderPresent(renderer);
+void Screen::ScrollRight() {
+  for (int plane = 0; plane < PLANES; plane++) {
+    if (!(planeMask >> plane & 1)) {
+      continue;
+    }
+    uint64_t *rows = Plane(plane);
+    if (hires) {
+      // Bits leaving the left word enter the right one
+      for (int y = 0; y < HIRES_Y_TILES; y++) {
+        uint64_t *row = rows + 2 * y;
+        row[1] = row[1] >> 4 | row[0] << 60;
+        row[0] >>= 4;
+      }
+    } else {
+      for (int y = 0; y < Y_TILES; y++) {
+        rows[y] >>= 4;
+      }
+    }
+  }
+  dirty = true;
+}
+
+void Screen::ScrollLeft() {
+  for (int plane = 0; plane < PLANES; plane++) {
+    if (!(planeMask >> plane & 1)) {
+      continue;
+    }
+    uint64_t *rows = Plane(plane);
+    if (hires) {
+      for (int y = 0; y < HIRES_Y_TILES; y++) {
+        uint64_t *row = rows + 2 * y;
+        row[0] = row[0] << 4 | row[1] >> 60;
+        row[1] <<= 4;
+      }
+    } else {
+      for (int y = 0; y < Y_TILES; y++) {
+        rows[y] <<= 4;
+      }
+    }
+  }
+  dirty = true;
 }
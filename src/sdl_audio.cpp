@@ -0,0 +1,42 @@
+#include "sdl_audio.hpp"
+#include <iostream>
+
+SDLAudio::SDLAudio() : buzzer(SAMPLE_RATE), device(0) {
+  SDL_AudioSpec wanted = {};
+  wanted.freq = SAMPLE_RATE;
+  wanted.format = AUDIO_S16SYS;
+  wanted.channels = 1;
+  wanted.samples = BUFFER_SAMPLES;
+  wanted.callback = Callback;
+  wanted.userdata = this;
+
+  // Exactly this format, so the callback never needs converting
+  SDL_AudioSpec obtained;
+  device = SDL_OpenAudioDevice(nullptr, 0, &wanted, &obtained, 0);
+  if (device == 0) {
+    std::cerr << "Error opening audio device: " << SDL_GetError()
+              << std::endl;
+    return;
+  }
+  SDL_PauseAudioDevice(device, 0);
+}
+
+SDLAudio::~SDLAudio() {
+  if (device != 0) {
+    SDL_CloseAudioDevice(device);
+  }
+}
+
+void SDLAudio::SetTone(bool on) {
+  buzzer.SetTone(on);
+}
+
+void SDLAudio::SetPattern(const uint8_t pattern[16], uint8_t pitch) {
+  buzzer.SetPattern(pattern, pitch);
+}
+
+void SDLAudio::Callback(void *userdata, Uint8 *stream, int length) {
+  SDLAudio *audio = static_cast<SDLAudio *>(userdata);
+  audio->buzzer.Fill(reinterpret_cast<int16_t *>(stream),
+                     length / static_cast<int>(sizeof(int16_t)));
+}
@@ -0,0 +1,109 @@
+#include "sdl_input.hpp"
+#include "input.hpp"
+#include "telemetry.hpp"
+#include <SDL2/SDL.h>
+
+SDLInput::SDLInput(Input &keypad) : keypad(keypad) {}
+
+void SDLInput::PollEvents() {
+  SDL_Event e;
+  while (SDL_PollEvent(&e)) {
+    HandleEvent(e);
+  }
+}
+
+void SDLInput::WaitEvents(int32_t timeoutMs) {
+  SDL_Event e;
+  int received = timeoutMs == FOREVER ? SDL_WaitEvent(&e)
+                                      : SDL_WaitEventTimeout(&e, timeoutMs);
+  if (received) {
+    HandleEvent(e);
+  }
+  PollEvents();
+}
+
+void SDLInput::HandleEvent(const SDL_Event &e) {
+  switch (e.type) {
+  case SDL_KEYDOWN:
+  case SDL_KEYUP: {
+    if (e.key.repeat) {
+      break; // Auto-repeat changes nothing
+    }
+    bool isPressed = (e.type == SDL_KEYDOWN);
+    // When the key went down, from SDL's millisecond event timestamp
+    uint64_t age = SDL_GetTicks() - e.key.timestamp;
+    uint64_t hostTime = Telemetry::NowNanos() - age * 1000000;
+    switch (e.key.keysym.scancode) {
+    case SDL_SCANCODE_1:
+      keypad.PostOrApplyKeyEvent(0x1, isPressed, hostTime);
+      break;
+    case SDL_SCANCODE_2:
+      keypad.PostOrApplyKeyEvent(0x2, isPressed, hostTime);
+      break;
+    case SDL_SCANCODE_3:
+      keypad.PostOrApplyKeyEvent(0x3, isPressed, hostTime);
+      break;
+    case SDL_SCANCODE_4:
+      keypad.PostOrApplyKeyEvent(0xC, isPressed, hostTime);
+      break;
+    case SDL_SCANCODE_Q:
+      keypad.PostOrApplyKeyEvent(0x4, isPressed, hostTime);
+      break;
+    case SDL_SCANCODE_W:
+      keypad.PostOrApplyKeyEvent(0x5, isPressed, hostTime);
+      break;
+    case SDL_SCANCODE_E:
+      keypad.PostOrApplyKeyEvent(0x6, isPressed, hostTime);
+      break;
+    case SDL_SCANCODE_R:
+      keypad.PostOrApplyKeyEvent(0xD, isPressed, hostTime);
+      break;
+    case SDL_SCANCODE_A:
+      keypad.PostOrApplyKeyEvent(0x7, isPressed, hostTime);
+      break;
+    case SDL_SCANCODE_S:
+      keypad.PostOrApplyKeyEvent(0x8, isPressed, hostTime);
+      break;
+    case SDL_SCANCODE_D:
+      keypad.PostOrApplyKeyEvent(0x9, isPressed, hostTime);
+      break;
+    case SDL_SCANCODE_F:
+      keypad.PostOrApplyKeyEvent(0xE, isPressed, hostTime);
+      break;
+    case SDL_SCANCODE_Z:
+      keypad.PostOrApplyKeyEvent(0xA, isPressed, hostTime);
+      break;
+    case SDL_SCANCODE_X:
+      keypad.PostOrApplyKeyEvent(0x0, isPressed, hostTime);
+      break;
+    case SDL_SCANCODE_C:
+      keypad.PostOrApplyKeyEvent(0xB, isPressed, hostTime);
+      break;
+    case SDL_SCANCODE_V:
+      keypad.PostOrApplyKeyEvent(0xF, isPressed, hostTime);
+      break;
+    case SDL_SCANCODE_BACKSPACE:
+      keypad.rewindHeld = isPressed;
+      break;
+    case SDL_SCANCODE_TAB:
+      if (isPressed) keypad.PressHotkey(Hotkey::FastForward);
+      break;
+    case SDL_SCANCODE_F5:
+      if (isPressed) keypad.PressHotkey(Hotkey::SaveState);
+      break;
+    case SDL_SCANCODE_F8:
+      if (isPressed) keypad.PressHotkey(Hotkey::DumpProfile);
+      break;
+    case SDL_SCANCODE_F9:
+      if (isPressed) keypad.PressHotkey(Hotkey::LoadState);
+      break;
+    default:
+      break;
+    }
+  } break;
+  case SDL_QUIT: {
+    keypad.quitRequested = true;
+    break;
+  }
+  }
+}
@@ -0,0 +1,102 @@
+#include "sdl_video.hpp"
+#include "screen.hpp"
+#include <iostream>
+
+const int SDLVideo::WIN_WIDTH = Screen::X_TILES * 15;
+const int SDLVideo::WIN_HEIGHT = Screen::Y_TILES * 15;
+const uint32_t SDLVideo::ON_COLOR = 0xFF00FF66;
+const uint32_t SDLVideo::OFF_COLOR = 0xFF0F0F28;
+const uint32_t SDLVideo::PLANE2_COLOR = 0xFFFF6600;
+const uint32_t SDLVideo::BOTH_COLOR = 0xFFFFFFFF;
+
+SDLVideo::SDLVideo(bool vsync)
+    : window(nullptr), renderer(nullptr), texture(nullptr), textureWidth(0) {
+  if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) != 0) {
+    std::cerr << "Error initializing SDL: " << SDL_GetError() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  window = SDL_CreateWindow("CHIP-8 Emulator", SDL_WINDOWPOS_CENTERED,
+                            SDL_WINDOWPOS_CENTERED, WIN_WIDTH, WIN_HEIGHT, 0);
+  if (window == nullptr) {
+    std::cerr << "Error creating window: " << SDL_GetError() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  // Prefer the GPU, fall back to software where there is none
+  Uint32 sync = vsync ? SDL_RENDERER_PRESENTVSYNC : 0;
+  renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | sync);
+  if (renderer == nullptr) {
+    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_SOFTWARE | sync);
+  }
+  if (renderer == nullptr) {
+    std::cerr << "Error creating renderer: " << SDL_GetError() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  CreateTexture(Screen::X_TILES, Screen::Y_TILES);
+}
+
+void SDLVideo::CreateTexture(int width, int height) {
+  if (texture) {
+    SDL_DestroyTexture(texture);
+  }
+
+  texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+                              SDL_TEXTUREACCESS_STREAMING, width, height);
+  if (texture == nullptr) {
+    std::cerr << "Error creating texture: " << SDL_GetError() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  textureWidth = width;
+}
+
+SDLVideo::~SDLVideo() {
+  if (texture) {
+    SDL_DestroyTexture(texture);
+    texture = nullptr;
+  }
+  if (renderer) {
+    SDL_DestroyRenderer(renderer);
+    renderer = nullptr;
+  }
+  if (window) {
+    SDL_DestroyWindow(window);
+    window = nullptr;
+  }
+
+  SDL_Quit();
+
+  std::cout << "Screen was destroyed" << std::endl;
+}
+
+void SDLVideo::Present(const Screen &screen) {
+  // One texel per pixel of the current resolution
+  if (screen.Width() != textureWidth) {
+    CreateTexture(screen.Width(), screen.Height());
+  }
+
+  void *pixels;
+  int pitch;
+  if (SDL_LockTexture(texture, nullptr, &pixels, &pitch) != 0) {
+    return;
+  }
+
+  static const uint32_t palette[4] = {OFF_COLOR, ON_COLOR, PLANE2_COLOR,
+                                      BOTH_COLOR};
+  screen.Render(static_cast<uint32_t *>(pixels), pitch, palette);
+
+  SDL_UnlockTexture(texture);
+
+  // Scaled to the whole window in one copy
+  SDL_RenderCopy(renderer, texture, nullptr, nullptr);
+  SDL_RenderPresent(renderer);
+}
+
+void SDLVideo::SetOverlayText(const std::string &text) {
+  std::string title = "CHIP-8 Emulator";
+  if (!text.empty()) {
+    title += " - " + text;
+  }
+  SDL_SetWindowTitle(window, title.c_str());
+}
@@ -0,0 +1,128 @@
+#include "telemetry.hpp"
+#include "input.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+LatencyHistogram::LatencyHistogram() : counts(), total(0) {}
+
+void LatencyHistogram::Add(double ms) {
+  int bucket = ms <= 0 ? 0 : static_cast<int>(ms / BUCKET_MS);
+  counts[std::min(bucket, BUCKETS)]++;
+  total++;
+}
+
+double LatencyHistogram::Percentile(double p) const {
+  if (total == 0) {
+    return 0;
+  }
+
+  uint64_t rank = static_cast<uint64_t>(p / 100 * total + 0.5);
+  rank = std::max<uint64_t>(rank, 1);
+  uint64_t seen = 0;
+  for (int bucket = 0; bucket <= BUCKETS; bucket++) {
+    seen += counts[bucket];
+    if (seen >= rank) {
+      return (bucket + 1) * BUCKET_MS;
+    }
+  }
+  return (BUCKETS + 1) * BUCKET_MS;
+}
+
+void LatencyHistogram::Write(std::ostream &out, const char *title) const {
+  char line[128];
+  snprintf(line, sizeof(line),
+           "%-22s n=%-7llu p50 %7.1f ms  p90 %7.1f ms  p99 %7.1f ms\n", title,
+           static_cast<unsigned long long>(total), Percentile(50),
+           Percentile(90), Percentile(99));
+  out << line;
+  if (total == 0) {
+    return;
+  }
+
+  // 2 ms rows up to 50 ms, then everything slower
+  const int ROW_BUCKETS = 20, ROWS = 25;
+  for (int row = 0; row <= ROWS; row++) {
+    uint64_t count = 0;
+    int first = row * ROW_BUCKETS;
+    int last = row == ROWS ? BUCKETS + 1 : first + ROW_BUCKETS;
+    for (int bucket = first; bucket < last; bucket++) {
+      count += counts[bucket];
+    }
+    if (count == 0) {
+      continue;
+    }
+
+    int bar = static_cast<int>(50 * count / total);
+    if (row == ROWS) {
+      snprintf(line, sizeof(line), "  %5.0f+ ms %8llu ", first * BUCKET_MS,
+               static_cast<unsigned long long>(count));
+    } else {
+      snprintf(line, sizeof(line), "  %5.0f-%-3.0f %8llu ", first * BUCKET_MS,
+               last * BUCKET_MS, static_cast<unsigned long long>(count));
+    }
+    out << line << std::string(bar, '#') << "\n";
+  }
+}
+
+Telemetry::Telemetry()
+    : stage(IDLE), eventTime(0), readTime(0), changeTime(0), lastRefresh(0) {}
+
+uint64_t Telemetry::NowNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void Telemetry::StartSample(Input &keypad, uint8_t key) {
+  uint64_t pressed = keypad.TakePressTime(key);
+  if (pressed == 0) {
+    return;
+  }
+
+  eventTime = pressed;
+  readTime = NowNanos();
+  stage = WAITING_FOR_CHANGE;
+}
+
+void Telemetry::OnPresent() {
+  if (stage != WAITING_FOR_PRESENT) {
+    return;
+  }
+
+  uint64_t presentTime = NowNanos();
+  inputToRead.Add((readTime - eventTime) / 1e6);
+  readToChange.Add((changeTime - readTime) / 1e6);
+  changeToPresent.Add((presentTime - changeTime) / 1e6);
+  inputToPresent.Add((presentTime - eventTime) / 1e6);
+  stage = IDLE;
+}
+
+void Telemetry::OnHostRefresh() {
+  uint64_t now = NowNanos();
+  if (lastRefresh != 0) {
+    frameTime.Add((now - lastRefresh) / 1e6);
+  }
+  lastRefresh = now;
+}
+
+std::string Telemetry::Summary() const {
+  char text[128];
+  snprintf(text, sizeof(text),
+           "key to pixels p50 %.1f / p99 %.1f ms | frame p50 %.1f / p99 %.1f ms",
+           inputToPresent.Percentile(50), inputToPresent.Percentile(99),
+           frameTime.Percentile(50), frameTime.Percentile(99));
+  return text;
+}
+
+void Telemetry::WriteReport(std::ostream &out) const {
+  out << "Input to display latency (" << inputToPresent.Count()
+      << " key presses sampled)\n";
+  inputToPresent.Write(out, "  total");
+  inputToRead.Write(out, "  event to read");
+  readToChange.Write(out, "  read to pixels");
+  changeToPresent.Write(out, "  pixels to present");
+  out << "Frame time\n";
+  frameTime.Write(out, "  host frame");
+}
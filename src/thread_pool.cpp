@@ -0,0 +1,109 @@
+#include "thread_pool.hpp"
+#include <algorithm>
+
+namespace {
+
+// Index of the worker running on this thread, -1 outside the pool
+thread_local int currentWorker = -1;
+thread_local const ThreadPool *currentPool = nullptr;
+
+} // namespace
+
+ThreadPool::ThreadPool(unsigned threads)
+    : queued(0), unfinished(0), stopping(false), nextQueue(0) {
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  for (unsigned i = 0; i < threads; i++) {
+    queues.emplace_back(new Queue);
+  }
+  for (unsigned i = 0; i < threads; i++) {
+    workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    stopping = true;
+  }
+  workAvailable.notify_all();
+
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+  size_t index = (currentPool == this)
+                     ? currentWorker
+                     : nextQueue.fetch_add(1) % queues.size();
+  {
+    std::lock_guard<std::mutex> lock(queues[index]->mutex);
+    queues[index]->tasks.push_back(std::move(task));
+  }
+  {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    queued++;
+    unfinished++;
+  }
+  workAvailable.notify_one();
+}
+
+void ThreadPool::Wait() {
+  std::unique_lock<std::mutex> lock(stateMutex);
+  allDone.wait(lock, [this] { return unfinished == 0; });
+}
+
+bool ThreadPool::TakeTask(unsigned self, std::function<void()> &task) {
+  // Own deque from the back (most recent, still warm in cache)
+  {
+    Queue &own = *queues[self];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      return true;
+    }
+  }
+
+  // Others from the front (oldest)
+  for (size_t i = 1; i < queues.size(); i++) {
+    Queue &victim = *queues[(self + i) % queues.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::WorkerLoop(unsigned self) {
+  currentWorker = self;
+  currentPool = this;
+
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(stateMutex);
+      workAvailable.wait(lock, [this] { return queued > 0 || stopping; });
+      if (queued == 0) {
+        return; // Stopping with nothing left to do
+      }
+      queued--; // Reserves one task, some deque is guaranteed to hold it
+    }
+
+    std::function<void()> task;
+    while (!TakeTask(self, task)) {
+      std::this_thread::yield(); // Pushed but raced with another taker
+    }
+    task();
+
+    std::lock_guard<std::mutex> lock(stateMutex);
+    if (--unfinished == 0) {
+      allDone.notify_all();
+    }
+  }
+}
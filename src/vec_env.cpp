@@ -0,0 +1,154 @@
+#include "vec_env.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+// Tasks per worker in a step; a few more than one evens out environments
+// that happen to run slower
+constexpr size_t TASKS_PER_THREAD = 4;
+
+// ORs each pair of pixels of a 64 pixel word into 32 bits, in order
+uint64_t HalveWord(uint64_t word) {
+  uint64_t x = (word | word << 1) >> 1 & 0x5555555555555555ULL;
+  x = (x | x >> 1) & 0x3333333333333333ULL;
+  x = (x | x >> 2) & 0x0F0F0F0F0F0F0F0FULL;
+  x = (x | x >> 4) & 0x00FF00FF00FF00FFULL;
+  x = (x | x >> 8) & 0x0000FFFF0000FFFFULL;
+  return (x | x >> 16) & 0xFFFFFFFFULL;
+}
+
+// Spreads 32 pixels over 64 bits, each pixel twice
+uint64_t DoubleWord(uint32_t half) {
+  uint64_t x = half;
+  x = (x | x << 16) & 0x0000FFFF0000FFFFULL;
+  x = (x | x << 8) & 0x00FF00FF00FF00FFULL;
+  x = (x | x << 4) & 0x0F0F0F0F0F0F0F0FULL;
+  x = (x | x << 2) & 0x3333333333333333ULL;
+  x = (x | x << 1) & 0x5555555555555555ULL;
+  return x | x << 1;
+}
+
+} // namespace
+
+VecEnv::VecEnv(uint32_t count, unsigned threads)
+    : instructionsPerFrame(CHIP8::CYCLES_PER_FRAME) {
+  for (uint32_t i = 0; i < count; i++) {
+    envs.emplace_back(new CHIP8);
+  }
+  if (threads != 1) {
+    pool.reset(new ThreadPool(threads));
+  }
+
+  // Until a ROM is loaded, resets go back to a blank machine
+  std::unique_ptr<CHIP8> blank(new CHIP8);
+  blank->CaptureState(initial);
+}
+
+bool VecEnv::LoadRom(const uint8_t *data, size_t size) {
+  if (size > CHIP8::MAX_MEMORY_SIZE - 0x200u) {
+    std::cerr << "ROM is too large to fit on CHIP-8 memory (max file size is "
+              << CHIP8::MAX_MEMORY_SIZE - 0x200u << " bytes)\n";
+    return false;
+  }
+
+  // Resets restore this snapshot, so each environment decodes it once
+  std::unique_ptr<CHIP8> fresh(new CHIP8);
+  if (size > CHIP8::MEMORY_SIZE - 0x200u) {
+    fresh->SetMemorySize(CHIP8::MAX_MEMORY_SIZE); // XO-CHIP program
+  }
+  memcpy(&fresh->memory[0x200], data, size);
+  fresh->CaptureState(initial);
+
+  Reset(0);
+  return true;
+}
+
+bool VecEnv::ReadRom(const char *filename) {
+  std::ifstream file(filename, std::ios::binary);
+  if (!file) {
+    std::cerr << "Error while opening the file\n";
+    return false;
+  }
+
+  std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)),
+                            std::istreambuf_iterator<char>());
+  return LoadRom(data.data(), data.size());
+}
+
+void VecEnv::Reset(uint64_t seed) {
+  for (uint32_t i = 0; i < envs.size(); i++) {
+    ResetOne(i, seed + i);
+  }
+}
+
+void VecEnv::ResetOne(uint32_t index, uint64_t seed) {
+  CHIP8 &env = *envs[index];
+  env.RestoreState(initial);
+  env.interpreter.rng.Seed(seed);
+  env.instructionsPerFrame = instructionsPerFrame;
+  for (int key = 0; key < 16; key++) {
+    env.keypad.SetKeyState(key, false);
+  }
+}
+
+void VecEnv::StepRange(const uint16_t *actions, uint32_t frames,
+                       size_t begin, size_t end) {
+  for (size_t i = begin; i < end; i++) {
+    CHIP8 &env = *envs[i];
+    for (int key = 0; key < 16; key++) {
+      env.keypad.SetKeyState(key, actions[i] >> key & 1);
+    }
+    env.instructionsPerFrame = instructionsPerFrame;
+    env.RunFrames(frames);
+  }
+}
+
+void VecEnv::Step(const uint16_t *actions, uint32_t frames) {
+  if (!pool || envs.size() < 2) {
+    StepRange(actions, frames, 0, envs.size());
+    return;
+  }
+
+  size_t tasks = std::min(envs.size(), pool->ThreadCount() * TASKS_PER_THREAD);
+  size_t chunk = (envs.size() + tasks - 1) / tasks;
+  for (size_t begin = 0; begin < envs.size(); begin += chunk) {
+    size_t end = std::min(envs.size(), begin + chunk);
+    pool->Submit([=] { StepRange(actions, frames, begin, end); });
+  }
+  pool->Wait();
+}
+
+void VecEnv::ObserveAll(uint64_t *out) const {
+  for (const std::unique_ptr<CHIP8> &env : envs) {
+    const uint64_t *rows = env->screen.buffer;
+    if (!env->screen.hires) {
+      memcpy(out, rows, OBSERVATION_WORDS * sizeof(uint64_t));
+    } else {
+      for (size_t y = 0; y < OBSERVATION_WORDS; y++) {
+        const uint64_t *pair = rows + 4 * y; // Two rows of two words
+        out[y] = HalveWord(pair[0] | pair[2]) << 32 |
+                 HalveWord(pair[1] | pair[3]);
+      }
+    }
+    out += OBSERVATION_WORDS;
+  }
+}
+
+void VecEnv::ObserveAllHires(uint64_t *out) const {
+  for (const std::unique_ptr<CHIP8> &env : envs) {
+    const uint64_t *rows = env->screen.buffer;
+    if (env->screen.hires) {
+      memcpy(out, rows, HIRES_OBSERVATION_WORDS * sizeof(uint64_t));
+    } else {
+      for (size_t y = 0; y < OBSERVATION_WORDS; y++) {
+        uint64_t *pair = out + 4 * y;
+        pair[0] = pair[2] = DoubleWord(rows[y] >> 32);
+        pair[1] = pair[3] = DoubleWord(rows[y] & 0xFFFFFFFF);
+      }
+    }
+    out += HIRES_OBSERVATION_WORDS;
+  }
+}
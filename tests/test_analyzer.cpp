@@ -0,0 +1,99 @@
+#include "catch.hpp"
+#include "analyzer.hpp"
+#include <sstream>
+
+namespace {
+
+const uint8_t ROM[] = {
+    0x22, 0x10, // 0x200 CALL 0x210
+    0x30, 0x00, // 0x202 SE V0, 0x00
+    0x12, 0x08, // 0x204 JP 0x208
+    0x00, 0xE0, // 0x206 CLS
+    0xA2, 0x14, // 0x208 LD I, 0x214
+    0xD0, 0x15, // 0x20A DRW V0, V1, 5
+    0xB2, 0x0E, // 0x20C JP V0, 0x20E
+    0x12, 0x0E, // 0x20E JP 0x20E, only reached through BNNN
+    0x60, 0x01, // 0x210 LD V0, 0x01
+    0x00, 0xEE, // 0x212 RET
+    0xF0, 0x90, 0x90, 0x90, 0xF0, // 0x214 sprite "0"
+};
+
+} // namespace
+
+TEST_CASE("Analyzer splits a ROM into basic blocks", "[ANALYZER]") {
+  RomAnalysis analysis;
+  REQUIRE(analysis.Analyze(ROM, sizeof(ROM)));
+
+  std::vector<uint16_t> starts;
+  for (const auto &entry : analysis.blocks) {
+    starts.push_back(entry.first);
+  }
+  REQUIRE(starts == std::vector<uint16_t>{0x200, 0x202, 0x204, 0x206, 0x208,
+                                          0x210});
+
+  const BasicBlock &call = analysis.blocks.at(0x200);
+  REQUIRE(call.call == 0x210);
+  REQUIRE(call.successors == std::vector<uint16_t>{0x202});
+  REQUIRE(analysis.blocks.at(0x202).successors ==
+          std::vector<uint16_t>{0x204, 0x206});
+  REQUIRE(analysis.blocks.at(0x206).successors ==
+          std::vector<uint16_t>{0x208}); // Falls through
+
+  const BasicBlock &draw = analysis.blocks.at(0x208);
+  REQUIRE(draw.end == 0x20E);
+  REQUIRE(draw.indirect);
+  REQUIRE(draw.successors.empty());
+  REQUIRE(analysis.blocks.at(0x210).returns);
+
+  REQUIRE(analysis.subroutines == std::vector<uint16_t>{0x210});
+  REQUIRE(analysis.indirectJumps == std::vector<uint16_t>{0x20C});
+  REQUIRE(analysis.externalTargets.empty());
+
+  REQUIRE(analysis.KindAt(0x20C) == ByteKind::Code);
+  REQUIRE(analysis.KindAt(0x20E) == ByteKind::Unreached);
+  for (uint16_t address = 0x214; address < 0x219; address++) {
+    REQUIRE(analysis.KindAt(address) == ByteKind::Sprite);
+  }
+}
+
+TEST_CASE("Analyzer finds halts and edges leaving the ROM", "[ANALYZER]") {
+  const uint8_t rom[] = {
+      0x32, 0x00, // 0x200 SE V2, 0x00
+      0x13, 0x00, // 0x202 JP 0x300
+      0x12, 0x04, // 0x204 JP 0x204
+  };
+  RomAnalysis analysis;
+  REQUIRE(analysis.Analyze(rom, sizeof(rom)));
+
+  REQUIRE(analysis.externalTargets == std::vector<uint16_t>{0x300});
+  REQUIRE(analysis.blocks.at(0x202).successors ==
+          std::vector<uint16_t>{0x300});
+  REQUIRE(analysis.blocks.at(0x204).halts);
+
+  REQUIRE_FALSE(analysis.Analyze(rom, 0));
+}
+
+TEST_CASE("Analyzer disassembles and draws the graph", "[ANALYZER]") {
+  REQUIRE(RomAnalysis::Disassemble(0x6133) == "LD V1, 0x33");
+  REQUIRE(RomAnalysis::Disassemble(0xD125) == "DRW V1, V2, 5");
+  REQUIRE(RomAnalysis::Disassemble(0xF000, 0x1234) == "LD I, 0x1234");
+  REQUIRE(RomAnalysis::Disassemble(0x0123) == "SYS 0x123");
+  REQUIRE(RomAnalysis::Disassemble(0xE1FF) == "DW 0xE1FF");
+
+  RomAnalysis analysis;
+  REQUIRE(analysis.Analyze(ROM, sizeof(ROM)));
+  std::ostringstream dot;
+  analysis.WriteDot(dot);
+  std::string graph = dot.str();
+
+  REQUIRE(graph.find("digraph rom {") == 0);
+  REQUIRE(graph.find("\"0x200\" -> \"0x202\";") != std::string::npos);
+  REQUIRE(graph.find("\"0x200\" -> \"0x210\" [style=dashed];") !=
+          std::string::npos);
+  REQUIRE(graph.find("color=red") != std::string::npos);
+
+  std::ostringstream text;
+  analysis.WriteText(text);
+  REQUIRE(text.str().find("0x214: sprite, 5 bytes") != std::string::npos);
+  REQUIRE(text.str().find("F0  ####....") != std::string::npos);
+}
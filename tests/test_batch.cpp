@@ -0,0 +1,66 @@
+#include "catch.hpp"
+#include "batch.hpp"
+#include "chip8.hpp"
+#include "thread_pool.hpp"
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+
+// Writes `size` bytes to `path`
+static void WriteFile(const char *path, const char *data, size_t size) {
+  std::ofstream file(path, std::ios::binary);
+  file.write(data, size);
+}
+
+TEST_CASE("Thread pool runs every task, including nested ones", "[BATCH]") {
+  std::atomic<int> ran(0);
+  ThreadPool pool(4);
+
+  for (int i = 0; i < 100; i++) {
+    pool.Submit([&] {
+      ran++;
+      pool.Submit([&] { ran++; });
+    });
+  }
+  pool.Wait();
+
+  REQUIRE(ran == 200);
+}
+
+TEST_CASE("Batch jobs match a direct run and follow their input script",
+          "[BATCH]") {
+  // F00A: V0 <- key, F029: I <- font(V0), D005: draw it, 1206: loop
+  const char rom[] = {'\xF0', '\x0A', '\xF0', '\x29', '\xD0', '\x05',
+                      '\x12', '\x06'};
+  WriteFile("build/batch_test.ch8", rom, sizeof(rom));
+  const char script[] = "# frame key action\n10 7 down\n12 7 up\n";
+  WriteFile("build/batch_test.txt", script, sizeof(script) - 1);
+
+  std::vector<BatchJob> jobs = {
+      {"build/batch_test.ch8", 60, "build/batch_test.txt"},
+      {"build/batch_test.ch8", 60, ""},
+      {"build/missing.ch8", 60, ""},
+  };
+  std::vector<BatchResult> results = RunBatch(jobs, BatchOptions(), 3);
+
+  CHIP8 direct;
+  REQUIRE(direct.ReadRom("build/batch_test.ch8"));
+  for (int frame = 0; frame < 60; frame++) {
+    if (frame == 10) direct.keypad.SetKeyState(7, true);
+    if (frame == 12) direct.keypad.SetKeyState(7, false);
+    direct.RunFrame();
+  }
+
+  REQUIRE(results[0].ok);
+  REQUIRE(results[0].cycles == direct.cycleCount);
+  REQUIRE(results[0].framebufferHash == direct.screen.Hash());
+
+  REQUIRE(results[1].ok); // Never gets a key, so nothing is drawn
+  REQUIRE(results[1].framebufferHash == CHIP8().screen.Hash());
+  REQUIRE(results[1].framebufferHash != results[0].framebufferHash);
+
+  REQUIRE_FALSE(results[2].ok);
+
+  remove("build/batch_test.ch8");
+  remove("build/batch_test.txt");
+}
@@ -0,0 +1,73 @@
+#include "catch.hpp"
+#include "buzzer.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+TEST_CASE("Buzzer fades a square wave in and out", "[AUDIO]") {
+  Buzzer buzzer(48000);
+  int16_t samples[480];
+
+  buzzer.Fill(samples, 480);
+  for (int16_t sample : samples) {
+    REQUIRE(sample == 0); // Silent until switched on
+  }
+
+  buzzer.SetTone(true);
+  buzzer.Fill(samples, 480);
+  REQUIRE(std::abs(samples[0]) < Buzzer::AMPLITUDE / 8); // No click
+  int edges = 0;
+  for (int i = 1; i < 480; i++) {
+    REQUIRE(std::abs(samples[i]) ==
+            Buzzer::AMPLITUDE * std::min(i + 1, Buzzer::RAMP_SAMPLES) /
+                Buzzer::RAMP_SAMPLES);
+    edges += (samples[i] > 0) != (samples[i - 1] > 0);
+  }
+  REQUIRE(edges == 8); // 10 ms of 440 Hz, two edges per period
+
+  buzzer.SetTone(false);
+  buzzer.Fill(samples, 480);
+  REQUIRE(std::abs(samples[0]) > Buzzer::AMPLITUDE / 2);
+  for (int i = Buzzer::RAMP_SAMPLES; i < 480; i++) {
+    REQUIRE(samples[i] == 0);
+  }
+}
+
+TEST_CASE("Buzzer loops an XO-CHIP pattern at its pitch", "[AUDIO]") {
+  Buzzer buzzer(48000);
+  uint8_t pattern[16];
+  for (uint8_t &byte : pattern) {
+    byte = 0xF0; // 4 bits on, 4 off
+  }
+  buzzer.SetTone(true);
+
+  // Pitch 64 plays 4000 bits a second, 12 samples each at 48 kHz
+  buzzer.SetPattern(pattern, 64);
+  int16_t samples[480];
+  buzzer.Fill(samples, 480);
+  for (int i = Buzzer::RAMP_SAMPLES; i < 480; i++) {
+    bool high = i % 96 < 48;
+    INFO("sample " << i);
+    REQUIRE(samples[i] == (high ? Buzzer::AMPLITUDE : -Buzzer::AMPLITUDE));
+  }
+
+  // 48 steps up doubles the rate
+  buzzer.SetPattern(pattern, 112);
+  buzzer.Fill(samples, 480);
+  int edges = 0;
+  for (int i = 1; i < 480; i++) {
+    edges += (samples[i] > 0) != (samples[i - 1] > 0);
+  }
+  REQUIRE(edges == 19); // Every 24 samples, 20 per 480, less the boundary
+
+  // Clearing the pattern brings back the 440 Hz square wave
+  memset(pattern, 0, sizeof(pattern));
+  buzzer.SetPattern(pattern, 64);
+  buzzer.Fill(samples, 480);
+  edges = 0;
+  for (int i = 1; i < 480; i++) {
+    edges += (samples[i] > 0) != (samples[i - 1] > 0);
+  }
+  REQUIRE(edges >= 8); // 4.4 periods, so 8 or 9 edges by phase
+  REQUIRE(edges <= 9);
+}
@@ -1,5 +1,10 @@
 #include "catch.hpp"
 #include "chip8.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
 
 TEST_CASE("Fonts are initialized between 050-09F", "[CHIP-8]") {
   CHIP8 c;
@@ -23,3 +28,454 @@ TEST_CASE("Sprite drawing results in correct behavior of VF", "[SCREEN]") {
   c.screen.drawSprite(0, 0, 4, sprite);
   REQUIRE(c.interpreter.V[0xF] == 1);
 }
+
+TEST_CASE("Sprites are clipped at the right and bottom edges", "[SCREEN]") {
+  CHIP8 c;
+  uint8_t sprite[] = {0xFF, 0xFF, 0xFF, 0xFF};
+
+  c.screen.drawSprite(60, 30, 4, sprite);
+  for (int y = 0; y < 32; y++) {
+    for (int x = 0; x < 64; x++) {
+      bool inside = x >= 60 && y >= 30;
+      REQUIRE(c.screen.GetPixel(x, y) == inside); // Nothing wraps around
+    }
+  }
+}
+
+TEST_CASE("Sprite origin wraps around the screen", "[SCREEN]") {
+  CHIP8 c;
+  uint8_t sprite[] = {0x81};
+
+  c.screen.drawSprite(64 + 3, 32 + 5, 1, sprite); // Same as (3, 5)
+  REQUIRE(c.screen.GetPixel(3, 5));
+  REQUIRE(c.screen.GetPixel(10, 5));
+  REQUIRE_FALSE(c.screen.GetPixel(4, 5));
+  REQUIRE(c.screen.buffer[5] == ((0x81ull << 56) >> 3));
+}
+
+TEST_CASE("Only DXYN and 00E0 mark the screen dirty", "[SCREEN]") {
+  CHIP8 c;
+  REQUIRE(c.screen.dirty); // First frame is always shown
+  c.screen.dirty = false;
+
+  c.interpreter.DecodeAndExecute(0x6005); // V0 <- 5
+  c.interpreter.DecodeAndExecute(0xA050); // I <- font "0"
+  REQUIRE_FALSE(c.screen.dirty);
+
+  c.interpreter.DecodeAndExecute(0xD005);
+  REQUIRE(c.screen.dirty);
+
+  c.screen.dirty = false;
+  c.interpreter.DecodeAndExecute(0x00E0);
+  REQUIRE(c.screen.dirty);
+}
+
+TEST_CASE("CHIP8 runs headless without backends", "[CHIP-8]") {
+  CHIP8 c;
+  REQUIRE(c.video == nullptr);
+  REQUIRE(c.audio == nullptr);
+  REQUIRE(c.input == nullptr);
+
+  // 6005: V0 <- 5, 7001: V0 += 1, 1202: loop on the add
+  uint8_t program[] = {0x60, 0x05, 0x70, 0x01, 0x12, 0x02};
+  memcpy(&c.memory[0x200], program, sizeof(program));
+
+  c.RunFrames(1); // 8 cycles: load, then 7 cycles alternating add/jump
+  REQUIRE(c.interpreter.V[0] == 5 + 4);
+}
+
+namespace {
+
+// Simulated time: only sleeps and event waits move it
+struct FakeClock : FrameClock {
+  mutable Clock::time_point now;
+  mutable int sleeps = 0;
+
+  Clock::time_point Now() const override { return now; }
+  void SleepUntil(Clock::time_point deadline) const override {
+    sleeps++;
+    now = std::max(now, deadline);
+  }
+};
+
+// Waits out its timeouts like a host with no events, and quits after a
+// number of frames
+struct WaitingInput : InputBackend {
+  CHIP8 &chip8;
+  FakeClock &clock;
+  uint64_t quitAfter;
+  int waits = 0;
+
+  WaitingInput(CHIP8 &chip8, FakeClock &clock, uint64_t quitAfter)
+      : chip8(chip8), clock(clock), quitAfter(quitAfter) {}
+
+  void PollEvents() override {
+    chip8.keypad.quitRequested = chip8.frameCount >= quitAfter;
+  }
+  void WaitEvents(int32_t timeoutMs) override {
+    waits++;
+    clock.now += std::chrono::milliseconds(timeoutMs);
+    PollEvents();
+  }
+};
+
+// Records the emulated frame every presented picture was taken at
+struct FrameVideo : VideoBackend {
+  const CHIP8 &chip8;
+  std::vector<uint64_t> presented;
+
+  explicit FrameVideo(const CHIP8 &chip8) : chip8(chip8) {}
+
+  void Present(const Screen &) override {
+    presented.push_back(chip8.frameCount);
+  }
+};
+
+} // namespace
+
+TEST_CASE("Run waits on host events between paced frames", "[CHIP-8]") {
+  CHIP8 c;
+  // 7001: V0 += 1, 1200: loop
+  uint8_t program[] = {0x70, 0x01, 0x12, 0x00};
+  memcpy(&c.memory[0x200], program, sizeof(program));
+  FakeClock clock;
+  WaitingInput input(c, clock, 6);
+  c.AttachBackends(nullptr, nullptr, &input);
+
+  c.Run(clock);
+
+  // Each frame waits on events for the whole milliseconds to its
+  // deadline, once, then sleeps the fraction left
+  REQUIRE(c.frameCount == 6);
+  REQUIRE(input.waits == 6);
+  REQUIRE(clock.sleeps == 6);
+  REQUIRE(clock.Elapsed() == Approx(6.0 / 60));
+}
+
+TEST_CASE("Fast-forward runs several frames per host frame", "[CHIP-8]") {
+  CHIP8 c;
+  // 00E0: clear, so every frame has something to present, 1200: loop
+  uint8_t program[] = {0x00, 0xE0, 0x12, 0x00};
+  memcpy(&c.memory[0x200], program, sizeof(program));
+  FakeClock clock;
+  WaitingInput input(c, clock, 60);
+  FrameVideo video(c);
+  c.AttachBackends(&video, nullptr, &input);
+  c.fastForwardSpeed = 20;
+  c.keypad.PressHotkey(Hotkey::FastForward);
+
+  c.Run(clock);
+
+  // One refresh per host frame, fastForwardSpeed emulated frames apart
+  REQUIRE(c.fastForward);
+  REQUIRE(c.frameCount == 60);
+  REQUIRE(video.presented == std::vector<uint64_t>{20, 40, 60});
+  REQUIRE(clock.Elapsed() == Approx(3.0 / 60));
+}
+
+TEST_CASE("Self-modifying code invalidates decoded instructions", "[CHIP-8]") {
+  CHIP8 c;
+  uint8_t program[] = {
+      0x6A, 0x05, // 200: VA <- 05 (patched below)
+      0x60, 0x6A, // 202: V0 <- 6A
+      0x61, 0x07, // 204: V1 <- 07
+      0xA2, 0x00, // 206: I <- 200
+      0xF1, 0x55, // 208: [I] <- V0, V1, so 200 becomes 6A07
+      0x12, 0x00  // 20A: JP 200
+  };
+  memcpy(&c.memory[0x200], program, sizeof(program));
+
+  for (int i = 0; i < 6; i++) {
+    c.interpreter.RunCycle();
+  }
+  REQUIRE(c.interpreter.V[0xA] == 0x05);
+  REQUIRE(c.interpreter.pc == 0x200);
+
+  c.interpreter.RunCycle(); // Must decode the patched instruction
+  REQUIRE(c.interpreter.V[0xA] == 0x07);
+}
+
+TEST_CASE("Frames run instructionsPerFrame cycles and one timer tick",
+          "[CHIP-8]") {
+  CHIP8 c;
+  c.instructionsPerFrame = 100;
+  c.interpreter.delayTimer = 10;
+  c.interpreter.V[0] = 0;
+
+  // 7001: V0 += 1, 1200: loop
+  uint8_t program[] = {0x70, 0x01, 0x12, 0x00};
+  memcpy(&c.memory[0x200], program, sizeof(program));
+
+  c.RunFrames(2);
+  REQUIRE(c.interpreter.V[0] == 100); // Half of the 200 cycles are adds
+  REQUIRE(c.interpreter.delayTimer == 8);
+  REQUIRE(c.cycleCount == 200);
+  REQUIRE(c.frameCount == 2);
+}
+
+TEST_CASE("Skipped idle loops end in the same state as running them",
+          "[CHIP-8]") {
+  uint8_t program[] = {
+      0x60, 0x0A, // 200: V0 <- 10
+      0xF0, 0x15, // 202: DT <- V0
+      0xF1, 0x07, // 204: V1 <- DT
+      0x31, 0x00, // 206: skip if V1 == 0
+      0x12, 0x04, // 208: JP 204
+      0xF2, 0x0A, // 20A: V2 <- key
+      0xF2, 0x29, // 20C: I <- font(V2)
+      0xD0, 0x05, // 20E: draw
+      0x12, 0x10  // 210: JP 210
+  };
+  CHIP8 skipping, running;
+  running.interpreter.skipIdle = false;
+  for (CHIP8 *c : {&skipping, &running}) {
+    memcpy(&c->memory[0x200], program, sizeof(program));
+    c->instructionsPerFrame = 11; // Not a multiple of the 3 cycle loop
+    c->keypad.PostKeyEvent(250, 0x7, true);
+    c->RunFrames(30);
+  }
+
+  REQUIRE(skipping.interpreter.idleCycles > 200);
+  REQUIRE(running.interpreter.idleCycles == 0);
+  REQUIRE(skipping.interpreter.pc == 0x210);
+  REQUIRE(skipping.interpreter.V[2] == 0x7);
+  REQUIRE(skipping.cycleCount == running.cycleCount);
+
+  MachineState a, b;
+  skipping.CaptureState(a);
+  running.CaptureState(b);
+  REQUIRE(memcmp(a.V, b.V, sizeof(a.V)) == 0);
+  REQUIRE(a.pc == b.pc);
+  REQUIRE(a.I == b.I);
+  REQUIRE(memcmp(a.framebuffer, b.framebuffer, sizeof(a.framebuffer)) == 0);
+
+  // Parked on the jump to itself with the timers stopped
+  REQUIRE(skipping.WaitingForInput());
+  REQUIRE_FALSE(running.WaitingForInput());
+}
+
+TEST_CASE("Hires 16x16 sprites straddle the word boundary", "[SCREEN]") {
+  CHIP8 c;
+  c.screen.SetHires(true);
+  REQUIRE(c.screen.Width() == 128);
+  REQUIRE(c.screen.Height() == 64);
+
+  uint8_t sprite[32];
+  memset(sprite, 0xFF, sizeof(sprite));
+  c.interpreter.V[0xF] = 0;
+  c.screen.drawSprite(56, 60, 0, sprite); // Clipped after 4 lines
+  for (int y = 0; y < 64; y++) {
+    for (int x = 0; x < 128; x++) {
+      bool inside = x >= 56 && x < 72 && y >= 60;
+      REQUIRE(c.screen.GetPixel(x, y) == inside);
+    }
+  }
+  REQUIRE(c.interpreter.V[0xF] == 0);
+
+  c.screen.drawSprite(56 + 128, 60, 0, sprite); // Wraps to the same spot
+  REQUIRE(c.interpreter.V[0xF] == 1);
+  REQUIRE_FALSE(c.screen.GetPixel(64, 60));
+}
+
+TEST_CASE("Scrolls move whole rows and carry across words", "[SCREEN]") {
+  CHIP8 c;
+  c.screen.SetHires(true);
+  uint8_t sprite[] = {0x01};
+  c.screen.drawSprite(56, 10, 1, sprite); // Pixel (63, 10)
+
+  c.screen.ScrollRight();
+  REQUIRE(c.screen.GetPixel(67, 10));
+  c.screen.ScrollLeft();
+  c.screen.ScrollLeft();
+  REQUIRE(c.screen.GetPixel(59, 10));
+  c.screen.ScrollDown(5);
+  REQUIRE(c.screen.GetPixel(59, 15));
+  c.screen.ScrollUp(15);
+  REQUIRE(c.screen.GetPixel(59, 0));
+  c.screen.ScrollUp(1); // Leaves through the top
+  for (int i = 0; i < Screen::BUFFER_WORDS; i++) {
+    REQUIRE(c.screen.buffer[i] == 0);
+  }
+
+  c.screen.SetHires(false);
+  c.screen.drawSprite(0, 31, 1, sprite); // Pixel (7, 31)
+  c.screen.ScrollRight();
+  REQUIRE(c.screen.buffer[31] == 1ull << (63 - 11));
+  c.screen.ScrollDown(1);
+  REQUIRE(c.screen.buffer[31] == 0);
+}
+
+TEST_CASE("Plane 2 draws from the bytes after plane 1", "[SCREEN]") {
+  CHIP8 c;
+  uint8_t sprite[] = {0x80, 0xC0};
+  c.screen.planeMask = 3;
+  REQUIRE(c.screen.SpriteBytes(1) == 2);
+  c.screen.drawSprite(0, 0, 1, sprite);
+  REQUIRE(c.screen.GetColor(0, 0) == 3);
+  REQUIRE(c.screen.GetColor(1, 0) == 2);
+
+  c.screen.planeMask = 2;
+  c.screen.Clear(); // Only the selected plane
+  REQUIRE(c.screen.GetColor(0, 0) == 1);
+}
+
+TEST_CASE("ROMs larger than 3584 bytes switch to 64kb of memory", "[CHIP-8]") {
+  CHIP8 c;
+  const char *path = "build/test_large.ch8";
+  std::vector<uint8_t> rom(0x2000, 0xAB);
+  FILE *f = fopen(path, "wb");
+  fwrite(rom.data(), 1, rom.size(), f);
+  fclose(f);
+
+  REQUIRE(c.memorySize == CHIP8::MEMORY_SIZE);
+  REQUIRE(c.ReadRom(path));
+  REQUIRE(c.memorySize == CHIP8::MAX_MEMORY_SIZE);
+  REQUIRE(c.memory[0x200 + 0x1FFF] == 0xAB);
+  remove(path);
+}
+
+TEST_CASE("Restoring a state resumes the exact same execution", "[STATE]") {
+  CHIP8 c;
+  // C00F: V0 <- rand & 0F, F029: I <- font(V0), D005: draw it, 00E0, 1200
+  uint8_t program[] = {0xC0, 0x0F, 0xF0, 0x29, 0xD0, 0x05,
+                       0x00, 0xE0, 0x12, 0x00};
+  memcpy(&c.memory[0x200], program, sizeof(program));
+  c.RunFrames(3);
+
+  MachineState saved;
+  c.CaptureState(saved);
+  c.RunFrames(5);
+  MachineState expected;
+  c.CaptureState(expected);
+
+  c.memory[0x208] = 0x00; // Patched code must be decoded again on restore
+  c.RestoreState(saved);
+  c.RunFrames(5);
+  MachineState actual;
+  c.CaptureState(actual);
+
+  REQUIRE(actual.memorySize == expected.memorySize);
+  REQUIRE(memcmp(actual.memory, expected.memory, actual.memorySize) == 0);
+  REQUIRE(memcmp(actual.framebuffer, expected.framebuffer,
+                 sizeof(actual.framebuffer)) == 0);
+  REQUIRE(actual.pc == expected.pc);
+  REQUIRE(actual.V[0] == expected.V[0]);
+  REQUIRE(memcmp(actual.rng, expected.rng, sizeof(actual.rng)) == 0);
+  REQUIRE(actual.cycleCount == expected.cycleCount);
+}
+
+TEST_CASE("Save state files round-trip and reject garbage", "[STATE]") {
+  CHIP8 c;
+  c.interpreter.V[3] = 0x42;
+  c.interpreter.sp = 2;
+  c.interpreter.stack[1] = 0x234;
+  c.screen.buffer[7] = 0x8000000000000001ULL;
+  c.frameCount = 99;
+
+  MachineState written;
+  c.CaptureState(written);
+  const char *path = "build/test.state";
+  REQUIRE(WriteState(written, path));
+
+  MachineState read;
+  REQUIRE(ReadState(read, path));
+  REQUIRE(read.V[3] == 0x42);
+  REQUIRE(read.sp == 2);
+  REQUIRE(read.stack[1] == 0x234);
+  REQUIRE(read.framebuffer[0][7] == 0x8000000000000001ULL);
+  REQUIRE(read.frameCount == 99);
+  REQUIRE(memcmp(read.rng, written.rng, sizeof(read.rng)) == 0);
+
+  FILE *f = fopen(path, "wb");
+  fputs("not a state", f);
+  fclose(f);
+  REQUIRE_FALSE(ReadState(read, path));
+  REQUIRE(read.frameCount == 99); // Left untouched on failure
+  remove(path);
+}
+
+TEST_CASE("Hires and plane state survive a restore", "[STATE]") {
+  CHIP8 c;
+  c.SetMemorySize(CHIP8::MAX_MEMORY_SIZE);
+  c.screen.SetHires(true);
+  c.screen.planeMask = 3;
+  c.screen.buffer2[100] = 0x1234;
+  c.memory[0xF000] = 0x42;
+  c.interpreter.flags[3] = 7;
+
+  MachineState saved;
+  c.CaptureState(saved);
+  CHIP8 d;
+  d.RestoreState(saved);
+  REQUIRE(d.memorySize == CHIP8::MAX_MEMORY_SIZE);
+  REQUIRE(d.screen.hires);
+  REQUIRE(d.screen.planeMask == 3);
+  REQUIRE(d.screen.buffer2[100] == 0x1234);
+  REQUIRE(d.memory[0xF000] == 0x42);
+  REQUIRE(d.interpreter.flags[3] == 7);
+  REQUIRE(d.screen.Hash() == c.screen.Hash());
+
+  // Back to a 4 KB state: nothing of the 64 KB program is left behind
+  CHIP8 e;
+  MachineState small;
+  e.CaptureState(small);
+  d.RestoreState(small);
+  REQUIRE(d.memorySize == CHIP8::MEMORY_SIZE);
+  d.SetMemorySize(CHIP8::MAX_MEMORY_SIZE);
+  REQUIRE(d.memory[0xF000] == 0);
+}
+
+TEST_CASE("Rewind steps back through captured frames", "[STATE]") {
+  CHIP8 c;
+  // 7001: V0 += 1, C10F: V1 <- rand, A050: I <- 050, F055: [I] <- V0, 1200
+  uint8_t program[] = {0x70, 0x01, 0xC1, 0x0F, 0xA0, 0x50,
+                       0xF0, 0x55, 0x12, 0x00};
+  memcpy(&c.memory[0x200], program, sizeof(program));
+
+  const uint32_t frames = Rewind::KEYFRAME_INTERVAL * 2 + 10;
+  std::vector<MachineState> history(frames);
+  for (uint32_t f = 0; f < frames; f++) {
+    c.RunFrame();
+    c.rewind.Capture(c);
+    c.CaptureState(history[f]);
+  }
+  REQUIRE(c.rewind.FramesStored() == frames);
+  // Keyframes hold the 4 KB that are addressable, not the 64 KB array
+  REQUIRE(c.rewind.BytesUsed() < 64 * 1024);
+
+  for (uint32_t f = frames - 1; f-- > 0;) {
+    REQUIRE(c.rewind.StepBack(c));
+    MachineState state;
+    c.CaptureState(state);
+    REQUIRE(memcmp(state.memory, history[f].memory, state.memorySize) == 0);
+    REQUIRE(state.V[0] == history[f].V[0]);
+    REQUIRE(memcmp(state.rng, history[f].rng, sizeof(state.rng)) == 0);
+    REQUIRE(state.cycleCount == history[f].cycleCount);
+  }
+  REQUIRE_FALSE(c.rewind.StepBack(c));
+}
+
+#ifdef CHIP8_PROFILE
+TEST_CASE("Profiling counts ops, addresses, draws and writes", "[PROFILE]") {
+  CHIP8 c;
+  uint8_t program[] = {
+      0xA3, 0x00, // 200: I <- 300
+      0x22, 0x08, // 202: CALL 208
+      0xF1, 0x55, // 204: [I] <- V0, V1
+      0x12, 0x04, // 206: JP 204
+      0xD0, 0x05, // 208: draw
+      0x00, 0xEE  // 20A: RET
+  };
+  memcpy(&c.memory[0x200], program, sizeof(program));
+  c.RunCycles(10); // Up to the RET, then three rounds of 204/206
+
+  const Profile &p = *c.profile;
+  REQUIRE(p.opCounts[OP_CALL] == 1);
+  REQUIRE(p.opCounts[OP_LD_I_VX] == 3);
+  REQUIRE(p.pcCounts[0x204] == 3);
+  REQUIRE(p.pcFunction[0x208] == 0x208);
+  REQUIRE(p.pcFunction[0x204] == 0x200);
+  REQUIRE(p.draws == 1);
+  REQUIRE(p.memoryWrites == 6);
+}
+#endif
@@ -0,0 +1,142 @@
+#include "catch.hpp"
+#include "chip8.hpp"
+#include "ensemble.hpp"
+#include <cstring>
+#include <memory>
+
+namespace {
+
+// Waits for a key, then loops through a key dependent branch, random
+// numbers and draws. Instances holding key 5 write over the VA load at
+// 21E, so they leave the shared program.
+const uint8_t ROM[] = {
+    0xF4, 0x0A,   // 200: V4 <- key
+    0x60, 0x05,   // 202: V0 <- 5
+    0xE0, 0x9E,   // 204: skip if key V0 down
+    0x12, 0x12,   // 206: JP 212
+    0x71, 0x01,   // 208: V1 += 1
+    0x60, 0x6A,   // 20A: V0 <- 6A
+    0xA2, 0x1E,   // 20C: I <- 21E
+    0xF1, 0x55,   // 20E: [I] <- V0, V1
+    0x12, 0x16,   // 210: JP 216
+    0x72, 0x01,   // 212: V2 += 1
+    0xC3, 0x0F,   // 214: V3 <- rand & F
+    0x82, 0x34,   // 216: V2 += V3
+    0xF4, 0x29,   // 218: I <- font(V4)
+    0xD5, 0x65,   // 21A: draw at V5, V6
+    0x75, 0x03,   // 21C: V5 += 3
+    0x6A, 0x00,   // 21E: VA <- 0 (rewritten)
+    0x12, 0x02,   // 220: JP 202
+};
+
+const uint32_t INSTANCES = 70; // Not a whole number of lane blocks
+const uint32_t IPF = 100;
+
+uint16_t KeysOf(uint32_t instance, uint32_t frame) {
+  if (instance % 5 == 0 && frame < 20) {
+    return 0; // Stuck on FX0A for a while
+  }
+  return 1 << ((instance + frame / 10) % 16);
+}
+
+} // namespace
+
+TEST_CASE("Ensemble instances match separate CHIP8 runs", "[ENSEMBLE]") {
+  for (int run = 0; run < 3; run++) {
+    bool vector = run > 0, skipIdle = run < 2;
+    Ensemble ensemble(INSTANCES);
+    if (!ensemble.UseVectorKernels(vector)) {
+      continue; // No AVX2 here
+    }
+    ensemble.instructionsPerFrame = IPF;
+    ensemble.skipIdle = skipIdle;
+    REQUIRE(ensemble.LoadRom(ROM, sizeof(ROM)));
+    for (uint32_t i = 0; i < INSTANCES; i++) {
+      ensemble.Seed(i, i);
+    }
+
+    const uint32_t frames = 40;
+    for (uint32_t frame = 0; frame < frames; frame++) {
+      for (uint32_t i = 0; i < INSTANCES; i++) {
+        ensemble.SetKeys(i, KeysOf(i, frame));
+      }
+      ensemble.RunFrame();
+    }
+    REQUIRE(ensemble.lockstepInstructions > 0);
+    REQUIRE((ensemble.idleInstructions > 0) == skipIdle); // The FX0A waits
+    REQUIRE(ensemble.lockstepInstructions + ensemble.scalarInstructions +
+                ensemble.idleInstructions ==
+            uint64_t(INSTANCES) * IPF * frames);
+
+    for (uint32_t i = 0; i < INSTANCES; i++) {
+      std::unique_ptr<CHIP8> chip8(new CHIP8);
+      chip8->instructionsPerFrame = IPF;
+      chip8->interpreter.rng.Seed(i);
+      memcpy(&chip8->memory[0x200], ROM, sizeof(ROM));
+      chip8->interpreter.InvalidateCache(0x200, sizeof(ROM));
+
+      for (uint32_t frame = 0; frame < frames; frame++) {
+        for (int key = 0; key < 16; key++) {
+          chip8->keypad.SetKeyState(key, KeysOf(i, frame) >> key & 1);
+        }
+        chip8->RunFrame();
+      }
+
+      INFO("instance " << i << " kernels " << ensemble.KernelName()
+                        << " skipIdle " << skipIdle);
+      for (int x = 0; x < 16; x++) {
+        REQUIRE(ensemble.GetV(i, x) == chip8->interpreter.V[x]);
+      }
+      REQUIRE(ensemble.GetPC(i) == chip8->interpreter.pc);
+      REQUIRE(ensemble.GetI(i) == chip8->interpreter.I);
+      REQUIRE(ensemble.GetDelayTimer(i) == chip8->interpreter.delayTimer);
+      REQUIRE(memcmp(ensemble.Framebuffer(i), chip8->screen.buffer,
+                     Screen::Y_TILES * sizeof(uint64_t)) == 0);
+      REQUIRE(memcmp(ensemble.Memory(i), chip8->memory,
+                     CHIP8::MEMORY_SIZE) == 0);
+    }
+  }
+}
+
+TEST_CASE("Ensemble instances wrap at the end of memory like CHIP8",
+          "[ENSEMBLE]") {
+  // A taken skip at FFE and a jump to the odd FFF both leave pc past the
+  // 4 KB; D010 draws nothing on the VIP
+  uint8_t rom[CHIP8::MEMORY_SIZE - 0x200] = {
+      0x70, 0x01,   // 200: V0 += 1
+      0x40, 0x01,   // 202: skip if V0 != 1
+      0x1F, 0xFE,   // 204: JP FFE
+      0x71, 0x01,   // 206: V1 += 1
+      0xD0, 0x10,   // 208: draw 16x16 at V0, V1 (SUPER-CHIP)
+      0x1F, 0xFF,   // 20A: JP FFF
+  };
+  rom[0xFFE - 0x200] = 0x40; // FFE: skip if V0 != 0
+  rom[0xFFF - 0x200] = 0x00;
+
+  const uint32_t instances = 3, frames = 5;
+  Ensemble ensemble(instances);
+  ensemble.instructionsPerFrame = IPF;
+  REQUIRE(ensemble.LoadRom(rom, sizeof(rom)));
+  for (uint32_t frame = 0; frame < frames; frame++) {
+    ensemble.RunFrame();
+  }
+
+  CHIP8 chip8;
+  chip8.instructionsPerFrame = IPF;
+  memcpy(&chip8.memory[0x200], rom, sizeof(rom));
+  chip8.interpreter.InvalidateCache(0x200, sizeof(rom));
+  for (uint32_t frame = 0; frame < frames; frame++) {
+    chip8.RunFrame();
+  }
+
+  for (uint32_t i = 0; i < instances; i++) {
+    INFO("instance " << i);
+    for (int x = 0; x < 16; x++) {
+      REQUIRE(ensemble.GetV(i, x) == chip8.interpreter.V[x]);
+    }
+    REQUIRE(ensemble.GetPC(i) == chip8.interpreter.pc);
+    REQUIRE(memcmp(ensemble.Framebuffer(i), chip8.screen.buffer,
+                   Screen::Y_TILES * sizeof(uint64_t)) == 0);
+  }
+  REQUIRE(chip8.interpreter.V[1] > 1); // Went round through FFF
+}
@@ -0,0 +1,106 @@
+#include "catch.hpp"
+#include "chip8.hpp"
+#include "input.hpp"
+#include "spsc_queue.hpp"
+#include <cstring>
+#include <thread>
+
+TEST_CASE("Key events take effect at the cycle they are stamped with",
+          "[INPUT]") {
+  CHIP8 c;
+  c.interpreter.V[0] = 0; // Key 0
+  c.interpreter.V[1] = 0;
+  uint8_t program[] = {
+      0x71, 0x01, // 200: V1 += 1
+      0xE0, 0x9E, // 202: skip if key V0 is down
+      0x12, 0x00, // 204: JP 200
+      0x12, 0x06  // 206: halt
+  };
+  memcpy(&c.memory[0x200], program, sizeof(program));
+
+  // Cycle 31 is the eleventh EX9E, in the middle of the fourth frame
+  REQUIRE(c.keypad.PostKeyEvent(31, 0x0, true));
+  c.RunFrames(5);
+
+  REQUIRE(c.interpreter.V[1] == 11);
+  REQUIRE(c.interpreter.pc == 0x206);
+  REQUIRE(c.keypad.IsKeyDown(0x0));
+  REQUIRE(c.keypad.NextEventCycle() == UINT64_MAX);
+}
+
+TEST_CASE("A key-up posted to a full queue is not lost", "[INPUT]") {
+  Input keypad;
+  keypad.PostOrApplyKeyEvent(0x3, true);
+  REQUIRE_FALSE(keypad.IsKeyDown(0x3)); // Queued for the next cycle
+  while (keypad.PostKeyEvent(Input::NOW, 0x3, true)) {
+  }
+
+  keypad.PostOrApplyKeyEvent(0x3, false);
+  REQUIRE_FALSE(keypad.IsKeyDown(0x3)); // Applied after the queued downs
+  REQUIRE(keypad.NextEventCycle() == UINT64_MAX);
+}
+
+TEST_CASE("Key events posted from another thread arrive in order", "[INPUT]") {
+  SpscQueue<uint32_t, 64> queue;
+  const uint32_t count = 100000;
+
+  std::thread producer([&] {
+    for (uint32_t i = 0; i < count; i++) {
+      while (!queue.Push(i)) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  uint32_t expected = 0;
+  bool inOrder = true;
+  while (expected < count) {
+    if (const uint32_t *value = queue.Peek()) {
+      inOrder = inOrder && *value == expected;
+      queue.Pop();
+      expected++;
+    }
+  }
+  producer.join();
+  REQUIRE(inOrder);
+  REQUIRE(queue.Peek() == nullptr);
+}
+
+TEST_CASE("Telemetry follows a key press through to the present", "[INPUT]") {
+  CHIP8 c;
+  c.telemetry.reset(new Telemetry);
+  c.interpreter.V[0] = 5; // Key 5
+  uint8_t program[] = {
+      0xE0, 0xA1, // 200: skip if key V0 is up
+      0x12, 0x06, // 202: JP 206
+      0x12, 0x00, // 204: JP 200
+      0xD1, 0x15, // 206: draw
+      0x12, 0x08  // 208: halt
+  };
+  memcpy(&c.memory[0x200], program, sizeof(program));
+
+  c.RunFrames(2); // Polling, nothing to sample yet
+  REQUIRE(c.telemetry->stage == Telemetry::IDLE);
+
+  c.keypad.PostKeyEvent(Input::NOW, 5, true, Telemetry::NowNanos());
+  c.RunFrames(1);
+  REQUIRE(c.telemetry->stage == Telemetry::WAITING_FOR_PRESENT);
+
+  c.telemetry->OnPresent();
+  REQUIRE(c.telemetry->stage == Telemetry::IDLE);
+  REQUIRE(c.telemetry->inputToPresent.Count() == 1);
+  REQUIRE(c.telemetry->inputToPresent.Percentile(50) < 1000);
+}
+
+TEST_CASE("Latency histogram percentiles", "[INPUT]") {
+  LatencyHistogram histogram;
+  for (int ms = 1; ms <= 100; ms++) {
+    histogram.Add(ms - 0.05);
+  }
+  REQUIRE(histogram.Count() == 100);
+  REQUIRE(histogram.Percentile(50) == Approx(50.0));
+  REQUIRE(histogram.Percentile(99) == Approx(99.0));
+
+  histogram.Add(5000); // Past the last bucket, still counted
+  REQUIRE(histogram.Percentile(100) > 1000);
+}
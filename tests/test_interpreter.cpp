@@ -4,6 +4,7 @@
 #include "chip8.hpp"
 #include "interpreter.hpp"
 #include "input.hpp"
+#include <cstring>
 
 static CHIP8 c;
 
@@ -13,12 +14,12 @@ TEST_CASE("Program counter starts at 0x200", "[Interpreter]") {
 
 // 00E0
 TEST_CASE("Opcode 0x00E0 (CLS) clears display", "[Interpreter and Screen]") {
-  memset(c.screen.buffer, true, sizeof(c.screen.buffer)); // Forcing all pixels to true
+  memset(c.screen.buffer, 0xFF, sizeof(c.screen.buffer)); // Forcing all pixels to true
   c.interpreter.DecodeAndExecute(0x00E0);                 // Calls instruction
   
   // Checks if instruction worked
   for (int i = 0; i < 64 * 32; i++) { 
-    REQUIRE_FALSE(c.screen.buffer[i]); 
+    REQUIRE_FALSE(c.screen.GetPixel(i % 64, i / 64)); 
   }
 }
 
@@ -307,7 +308,7 @@ TEST_CASE("Opcode 0xBNNN jumps to loaction NNN + V0",
 TEST_CASE("Opcode EX9E skip next instruction if key (Vx) pressed",
           "[Interpreter]") {
   c.interpreter.V[0] = 2;
-  Input::GetKeyStateForTest()[2] = true;
+  c.keypad.GetKeyStateForTest()[2] = true;
   uint16_t firstPC = c.interpreter.pc;
   c.interpreter.DecodeAndExecute(0xE09E);
   REQUIRE(c.interpreter.pc == firstPC + 2);
@@ -316,11 +317,11 @@ TEST_CASE("Opcode EX9E skip next instruction if key (Vx) pressed",
 // EXA1
 TEST_CASE("Opcode EXA1 skip next instruction if key (Vx) not presed", 
           "[Interpreter]") {
-  Input::GetKeyStateForTest()[2] = true;
+  c.keypad.GetKeyStateForTest()[2] = true;
   uint16_t firstPC = c.interpreter.pc;
   c.interpreter.DecodeAndExecute(0xE0A1);
   REQUIRE(c.interpreter.pc == firstPC); // Key is pressed
-  Input::GetKeyStateForTest()[2] = false;
+  c.keypad.GetKeyStateForTest()[2] = false;
   c.interpreter.DecodeAndExecute(0xE0A1);
   REQUIRE(c.interpreter.pc == firstPC + 2); // Key not pressed
 }
@@ -337,12 +338,12 @@ TEST_CASE("Opcode FX0A Waits for a key to be pressed, and store the value in "
           "Vx (stops all execution)",
           "[Interpreter]") {
   uint16_t firstPC = c.interpreter.pc;
-  memset(Input::GetKeyStateForTest(), false, 16); // No key is pressed
+  memset(c.keypad.GetKeyStateForTest(), false, 16); // No key is pressed
   c.interpreter.DecodeAndExecute(0xF00A);
   REQUIRE(c.interpreter.pc == firstPC - 2); // Equivalent to stop the execution
   
   c.interpreter.pc += 2; // Fetch byte x 2
-  Input::GetKeyStateForTest()[2] = true; // A key is pressed
+  c.keypad.GetKeyStateForTest()[2] = true; // A key is pressed
   c.interpreter.DecodeAndExecute(0xF00A);
   REQUIRE(c.interpreter.pc == firstPC);
 }
@@ -367,3 +368,180 @@ TEST_CASE("Opcode FX29 sets I to location of sprite with digit Vx ", "[Interpret
   c.interpreter.DecodeAndExecute(0xF429); // Sprite for font digit 0
   REQUIRE(c.interpreter.I == 0x50); // Location of sprite '0'
 }
+
+// CXNN
+TEST_CASE("Opcode CXNN is reproducible for a given seed", "[Interpreter]") {
+  CHIP8 a, b;
+  a.interpreter.rng.Seed(1234);
+  b.interpreter.rng.Seed(1234);
+
+  bool same = true, masked = true;
+  for (int i = 0; i < 1000; i++) {
+    a.interpreter.DecodeAndExecute(0xC5F0);
+    b.interpreter.DecodeAndExecute(0xC5F0);
+    same = same && a.interpreter.V[5] == b.interpreter.V[5];
+    masked = masked && (a.interpreter.V[5] & 0x0F) == 0;
+  }
+  REQUIRE(same);
+  REQUIRE(masked);
+
+  b.interpreter.rng.Seed(1235);
+  int differ = 0;
+  for (int i = 0; i < 100; i++) {
+    a.interpreter.DecodeAndExecute(0xC5FF);
+    b.interpreter.DecodeAndExecute(0xC5FF);
+    differ += a.interpreter.V[5] != b.interpreter.V[5];
+  }
+  REQUIRE(differ > 90);
+}
+
+// 00FE, 00FF
+TEST_CASE("Opcodes 00FF and 00FE switch resolution and clear", "[Interpreter]") {
+  CHIP8 h;
+  h.SetQuirks(QuirkProfile::SuperChip);
+  h.screen.buffer[0] = 1;
+  h.interpreter.DecodeAndExecute(0x00FF);
+  REQUIRE(h.screen.hires);
+  REQUIRE(h.screen.buffer[0] == 0);
+  h.interpreter.DecodeAndExecute(0x00FE);
+  REQUIRE_FALSE(h.screen.hires);
+}
+
+// FX30
+TEST_CASE("Opcode FX30 points I at the big font digit", "[Interpreter]") {
+  CHIP8 h;
+  h.SetQuirks(QuirkProfile::SuperChip);
+  h.interpreter.V[2] = 3;
+  h.interpreter.DecodeAndExecute(0xF230);
+  REQUIRE(h.interpreter.I == CHIP8::BIG_FONT_DATA_START + 30);
+}
+
+// FX75, FX85
+TEST_CASE("Opcodes FX75 and FX85 save and load flag registers", "[Interpreter]") {
+  CHIP8 h;
+  h.SetQuirks(QuirkProfile::SuperChip);
+  for (int i = 0; i < 4; i++) h.interpreter.V[i] = 10 + i;
+  h.interpreter.DecodeAndExecute(0xF375);
+  memset(h.interpreter.V, 0, sizeof(h.interpreter.V));
+  h.interpreter.DecodeAndExecute(0xF385);
+  for (int i = 0; i < 4; i++) REQUIRE(h.interpreter.V[i] == 10 + i);
+}
+
+// 5XY2, 5XY3
+TEST_CASE("Opcodes 5XY2 and 5XY3 store and load a register range",
+          "[Interpreter]") {
+  CHIP8 h;
+  h.SetQuirks(QuirkProfile::XoChip);
+  h.interpreter.I = 0x300;
+  h.interpreter.V[1] = 1;
+  h.interpreter.V[2] = 2;
+  h.interpreter.V[3] = 3;
+  h.interpreter.DecodeAndExecute(0x5312); // Descending: V3, V2, V1
+  REQUIRE(h.memory[0x300] == 3);
+  REQUIRE(h.memory[0x302] == 1);
+  REQUIRE(h.interpreter.I == 0x300); // I is left alone
+
+  h.interpreter.DecodeAndExecute(0x5573); // V5, V6, V7 <- 3, 2, 1
+  REQUIRE(h.interpreter.V[5] == 3);
+  REQUIRE(h.interpreter.V[7] == 1);
+}
+
+// F000 NNNN
+TEST_CASE("Opcode F000 loads a 16-bit I and is skipped whole", "[Interpreter]") {
+  CHIP8 h, vip;
+  h.SetMemorySize(CHIP8::MAX_MEMORY_SIZE);
+  h.SetQuirks(QuirkProfile::XoChip);
+  // 3000: skip if V0 == 0, F000 ABCD, 6155
+  uint8_t program[] = {0x30, 0x00, 0xF0, 0x00, 0xAB, 0xCD, 0x61, 0x55};
+  memcpy(&h.memory[0x200], program, sizeof(program));
+  h.RunCycles(2);
+  REQUIRE(h.interpreter.V[1] == 0x55);
+  REQUIRE(h.interpreter.I == 0);
+
+  h.interpreter.pc = 0x202;
+  h.RunCycles(1);
+  REQUIRE(h.interpreter.I == 0xABCD);
+  REQUIRE(h.interpreter.pc == 0x206);
+
+  // Other profiles have no F000 NNNN and skip two bytes, into ABCD
+  memcpy(&vip.memory[0x200], program, sizeof(program));
+  vip.RunCycles(2);
+  REQUIRE(vip.interpreter.I == 0xBCD);
+  REQUIRE(vip.interpreter.pc == 0x206);
+}
+
+TEST_CASE("Quirk profiles change the instructions variants disagree on",
+          "[Interpreter]") {
+  CHIP8 vip, schip;
+  schip.SetQuirks(QuirkProfile::SuperChip);
+  for (CHIP8 *h : {&vip, &schip}) {
+    h->interpreter.V[1] = 0x03;
+    h->interpreter.V[2] = 0x80;
+    h->interpreter.V[0xF] = 7;
+    h->interpreter.DecodeAndExecute(0x8121); // V1 |= V2
+    h->interpreter.DecodeAndExecute(0x8326); // V3 <- V2 or V3 >> 1
+    h->interpreter.I = 0x300;
+    h->interpreter.DecodeAndExecute(0xF155); // [I] <- V0, V1
+    h->interpreter.V[0] = 0x10;
+    h->interpreter.DecodeAndExecute(0xB220); // JP V0 / V2 + 220
+  }
+
+  REQUIRE(vip.interpreter.V[1] == 0x83);
+  REQUIRE(schip.interpreter.V[1] == 0x83);
+  REQUIRE(vip.interpreter.V[3] == 0x40);   // Shifted V2
+  REQUIRE(schip.interpreter.V[3] == 0x00); // Shifted V3 (was 0)
+  REQUIRE(vip.interpreter.I == 0x302);
+  REQUIRE(schip.interpreter.I == 0x300);
+  REQUIRE(vip.interpreter.pc == 0x230);
+  REQUIRE(schip.interpreter.pc == 0x2A0);
+}
+
+TEST_CASE("COSMAC VIP runs the later variants' opcodes as before",
+          "[Interpreter]") {
+  CHIP8 vip;
+  vip.interpreter.V[1] = 5;
+  vip.interpreter.V[2] = 5;
+  vip.interpreter.V[0xF] = 7;
+  vip.memory[0x300] = 0xFF;
+  vip.interpreter.I = 0x300;
+  // 5122 SE V1, V2; 5123 likewise; D120 draws nothing
+  uint8_t program[] = {0x51, 0x22, 0x00, 0x00, 0x51, 0x23, 0x00, 0x00,
+                       0xD1, 0x20, 0x00, 0xFF, 0xF0, 0x01};
+  memcpy(&vip.memory[0x200], program, sizeof(program));
+  vip.RunCycles(2);
+  REQUIRE(vip.interpreter.pc == 0x208);
+  REQUIRE(vip.interpreter.V[1] == 5);
+  REQUIRE(vip.memory[0x300] == 0xFF);
+
+  // 00FF and F001 are no-ops too
+  vip.RunCycles(3);
+  REQUIRE(vip.interpreter.pc == 0x20E);
+  REQUIRE(vip.interpreter.V[0xF] == 7);
+  REQUIRE_FALSE(vip.screen.hires);
+  for (int x = 0; x < 64; x++) {
+    for (int y = 0; y < 32; y++) {
+      REQUIRE_FALSE(vip.screen.GetPixel(x, y));
+    }
+  }
+}
+
+TEST_CASE("XO-CHIP sprites wrap around the screen edges", "[Interpreter]") {
+  CHIP8 h;
+  h.SetQuirks(QuirkProfile::XoChip);
+  h.memory[0x300] = 0xFF;
+  h.memory[0x301] = 0xFF;
+  h.interpreter.I = 0x300;
+  h.interpreter.V[0] = 60;
+  h.interpreter.V[1] = 31;
+  h.interpreter.DecodeAndExecute(0xD012);
+  REQUIRE(h.screen.GetPixel(63, 31));
+  REQUIRE(h.screen.GetPixel(3, 31));  // Past the right edge
+  REQUIRE(h.screen.GetPixel(0, 0));   // Past the bottom
+  REQUIRE_FALSE(h.screen.GetPixel(4, 0));
+
+  h.screen.SetHires(true);
+  h.interpreter.V[0] = 124;
+  h.interpreter.DecodeAndExecute(0xD011);
+  REQUIRE(h.screen.GetPixel(127, 31));
+  REQUIRE(h.screen.GetPixel(3, 31));   // Into the left word
+}
@@ -0,0 +1,141 @@
+#include "catch.hpp"
+#include "chip8.hpp"
+#include <cstring>
+
+// Every instruction the JIT translates, between skips and jumps it leaves
+// to the interpreter
+static const uint8_t aluProgram[] = {
+    0x60, 0xF0, // 200: V0 <- F0
+    0x61, 0x33, // 202: V1 <- 33
+    0x70, 0x25, // 204: V0 += 25
+    0x82, 0x00, // 206: V2 <- V0
+    0x82, 0x11, // 208: V2 |= V1
+    0x83, 0x02, // 20A: V3 &= V0
+    0x84, 0x13, // 20C: V4 ^= V1
+    0x80, 0x14, // 20E: V0 += V1
+    0x85, 0x05, // 210: V5 -= V0
+    0x86, 0x16, // 212: V6 <- V1 >> 1
+    0x87, 0x07, // 214: V7 <- V0 - V7
+    0x88, 0x1E, // 216: V8 <- V1 << 1
+    0xA3, 0x00, // 218: I <- 300
+    0xF0, 0x1E, // 21A: I += V0
+    0x3F, 0x01, // 21C: skip if VF == 1
+    0x71, 0x01, // 21E: V1 += 1
+    0x12, 0x04  // 220: JP 204
+};
+
+static void LoadProgram(CHIP8 &c, const uint8_t *program, size_t size) {
+  memcpy(&c.memory[0x200], program, size);
+  c.interpreter.InvalidateCache(0x200, size);
+}
+
+TEST_CASE("JIT matches the interpreter cycle by cycle", "[JIT]") {
+  if (!Jit::IsSupported()) {
+    return;
+  }
+
+  for (QuirkProfile profile : {QuirkProfile::CosmacVip,
+                               QuirkProfile::SuperChip,
+                               QuirkProfile::XoChip}) {
+    CHIP8 interpreted, compiled;
+    REQUIRE(compiled.UseJit(true));
+    interpreted.SetQuirks(profile);
+    compiled.SetQuirks(profile);
+    LoadProgram(interpreted, aluProgram, sizeof(aluProgram));
+    LoadProgram(compiled, aluProgram, sizeof(aluProgram));
+    // Same starting registers whatever the constructor leaves in them
+    for (CHIP8 *c : {&interpreted, &compiled}) {
+      memset(c->interpreter.V, 0, 16);
+      memset(c->interpreter.stack, 0, sizeof(c->interpreter.stack));
+      c->interpreter.I = 0;
+      c->interpreter.sp = 0;
+    }
+
+    // Odd budgets split blocks, so partial blocks are interpreted
+    for (uint32_t cycles : {1u, 7u, 3u, 40u, 13u, 1000u}) {
+      interpreted.RunCycles(cycles);
+      compiled.RunCycles(cycles);
+
+      REQUIRE(compiled.interpreter.pc == interpreted.interpreter.pc);
+      REQUIRE(compiled.interpreter.I == interpreted.interpreter.I);
+      REQUIRE(memcmp(compiled.interpreter.V, interpreted.interpreter.V, 16) ==
+              0);
+    }
+    REQUIRE(compiled.jit->compiledBlocks > 0);
+  }
+}
+
+TEST_CASE("JIT recompiles blocks overwritten by FX55", "[JIT]") {
+  if (!Jit::IsSupported()) {
+    return;
+  }
+
+  CHIP8 c;
+  REQUIRE(c.UseJit(true));
+  uint8_t program[] = {
+      0x6A, 0x05, // 200: VA <- 05 (patched below)
+      0x60, 0x6A, // 202: V0 <- 6A
+      0x61, 0x07, // 204: V1 <- 07
+      0xA2, 0x00, // 206: I <- 200
+      0xF1, 0x55, // 208: [I] <- V0, V1, so 200 becomes 6A07
+      0x12, 0x00  // 20A: JP 200
+  };
+  LoadProgram(c, program, sizeof(program));
+
+  c.RunCycles(6); // Block 200-206, then FX55 and the jump
+  REQUIRE(c.interpreter.V[0xA] == 0x05);
+  REQUIRE(c.jit->compiledBlocks == 1);
+
+  c.RunCycles(4); // Same block, compiled again from the patched code
+  REQUIRE(c.interpreter.V[0xA] == 0x07);
+  REQUIRE(c.jit->compiledBlocks == 2);
+}
+
+TEST_CASE("JIT skips, jumps and idles like the interpreter", "[JIT]") {
+  if (!Jit::IsSupported()) {
+    return;
+  }
+
+  uint8_t program[] = {
+      0x60, 0x03, // 200: V0 <- 3
+      0x61, 0x03, // 202: V1 <- 3
+      0x50, 0x10, // 204: skip if V0 == V1
+      0x62, 0x01, // 206: V2 <- 1 (skipped)
+      0x90, 0x10, // 208: skip if V0 != V1
+      0x40, 0x03, // 20A: skip if V0 != 3
+      0x30, 0x03, // 20C: skip if V0 == 3, over F000 NNNN whole on XO-CHIP
+      0xF0, 0x00, // 20E: I <- long
+      0x03, 0x00, // 210: (address, or a no-op)
+      0xD0, 0x11, // 212: draw, interpreted
+      0xF0, 0x15, // 214: DT <- V0
+      0xF3, 0x07, // 216: V3 <- DT
+      0x33, 0x00, // 218: skip if V3 == 0
+      0x12, 0x16, // 21A: JP 216
+      0x73, 0x01, // 21C: V3 += 1
+      0x12, 0x1E  // 21E: JP 21E
+  };
+
+  for (QuirkProfile profile : {QuirkProfile::CosmacVip, QuirkProfile::XoChip}) {
+    CHIP8 interpreted, compiled;
+    REQUIRE(compiled.UseJit(true));
+    interpreted.SetQuirks(profile);
+    compiled.SetQuirks(profile);
+    LoadProgram(interpreted, program, sizeof(program));
+    LoadProgram(compiled, program, sizeof(program));
+
+    for (uint32_t frame = 0; frame < 6; frame++) {
+      interpreted.RunFrame();
+      compiled.RunFrame();
+
+      INFO("frame " << frame);
+      REQUIRE(compiled.interpreter.pc == interpreted.interpreter.pc);
+      REQUIRE(compiled.interpreter.I == interpreted.interpreter.I);
+      REQUIRE(memcmp(compiled.interpreter.V, interpreted.interpreter.V, 16) ==
+              0);
+    }
+    REQUIRE(compiled.interpreter.pc == 0x21E);
+    // The timer poll and the jump to itself were spun, not stepped
+    REQUIRE(compiled.interpreter.idleCycles ==
+            interpreted.interpreter.idleCycles);
+  }
+}
@@ -0,0 +1,139 @@
+#include "catch.hpp"
+#include "chip8_env.h"
+#include "vec_env.hpp"
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+namespace {
+
+// Draws font(V0) at a random column, V0 being the lowest key held (via
+// EXA1 skips over keys 0..15), then loops
+const uint8_t ROM[] = {
+    0x00, 0xE0,   // 200: CLS
+    0x60, 0x00,   // 202: V0 <- 0
+    0xE0, 0xA1,   // 204: skip if key V0 up
+    0x12, 0x0E,   // 206: JP 20E
+    0x70, 0x01,   // 208: V0 += 1
+    0x30, 0x10,   // 20A: skip if V0 == 16
+    0x12, 0x04,   // 20C: JP 204
+    0xC1, 0x3F,   // 20E: V1 <- rand & 3F
+    0xF0, 0x29,   // 210: I <- font(V0)
+    0xD1, 0x25,   // 212: draw at V1, V2
+    0x12, 0x00,   // 214: JP 200
+};
+
+} // namespace
+
+TEST_CASE("Vector environments match single CHIP8 runs", "[ENV]") {
+  const uint32_t count = 37;
+  VecEnv vec(count, 4);
+  vec.instructionsPerFrame = 50;
+  REQUIRE(vec.LoadRom(ROM, sizeof(ROM)));
+  vec.Reset(100);
+
+  std::vector<uint16_t> actions(count);
+  for (int step = 0; step < 10; step++) {
+    for (uint32_t i = 0; i < count; i++) {
+      actions[i] = (i * 7 + step) & 0xFFFF;
+    }
+    vec.Step(actions.data(), 3);
+  }
+
+  std::vector<uint64_t> all(count * VecEnv::OBSERVATION_WORDS);
+  vec.ObserveAll(all.data());
+
+  for (uint32_t i = 0; i < count; i++) {
+    std::unique_ptr<CHIP8> chip8(new CHIP8);
+    chip8->instructionsPerFrame = 50;
+    chip8->interpreter.rng.Seed(100 + i);
+    memcpy(&chip8->memory[0x200], ROM, sizeof(ROM));
+    chip8->interpreter.InvalidateCache(0x200, sizeof(ROM));
+    for (int step = 0; step < 10; step++) {
+      for (int key = 0; key < 16; key++) {
+        chip8->keypad.SetKeyState(key, ((i * 7 + step) & 0xFFFF) >> key & 1);
+      }
+      chip8->RunFrames(3);
+    }
+
+    INFO("environment " << i);
+    REQUIRE(memcmp(vec.Observe(i), chip8->screen.buffer,
+                   sizeof(chip8->screen.buffer)) == 0);
+    REQUIRE(memcmp(&all[i * VecEnv::OBSERVATION_WORDS], chip8->screen.buffer,
+                   VecEnv::OBSERVATION_WORDS * sizeof(uint64_t)) == 0);
+    REQUIRE(vec.Env(i).cycleCount == chip8->cycleCount);
+  }
+}
+
+TEST_CASE("C interface resets to the same trajectory", "[ENV]") {
+  {
+    std::ofstream file("build/env_test.ch8", std::ios::binary);
+    file.write(reinterpret_cast<const char *>(ROM), sizeof(ROM));
+  }
+  REQUIRE(chip8_env_create("build/missing.ch8", 4, 1) == nullptr);
+
+  chip8_env *env = chip8_env_create("build/env_test.ch8", 4, 2);
+  REQUIRE(env != nullptr);
+  REQUIRE(chip8_env_size(env) == 4);
+  chip8_env_set_instructions_per_frame(env, 40);
+
+  const uint16_t actions[4] = {0x0001, 0x0020, 0x0400, 0x8000};
+  uint64_t first[4 * CHIP8_ENV_OBSERVATION_WORDS];
+  uint64_t second[4 * CHIP8_ENV_OBSERVATION_WORDS];
+
+  REQUIRE(chip8_env_reset(env, 7) == 0);
+  REQUIRE(chip8_env_step(env, actions, 5) == 0);
+  REQUIRE(chip8_env_observe_all(env, first) == 0);
+
+  REQUIRE(chip8_env_reset(env, 7) == 0);
+  REQUIRE(chip8_env_step(env, actions, 5) == 0);
+  REQUIRE(chip8_env_observe_all(env, second) == 0);
+  REQUIRE(memcmp(first, second, sizeof(first)) == 0);
+  REQUIRE(memcmp(chip8_env_observe(env, 2),
+                 &first[2 * CHIP8_ENV_OBSERVATION_WORDS],
+                 CHIP8_ENV_OBSERVATION_WORDS * sizeof(uint64_t)) == 0);
+
+  // Something was drawn, and different keys drew different digits
+  REQUIRE(memcmp(&first[0], &first[CHIP8_ENV_OBSERVATION_WORDS],
+                 CHIP8_ENV_OBSERVATION_WORDS * sizeof(uint64_t)) != 0);
+
+  // Indexes past the end are errors, not reads out of bounds
+  REQUIRE(chip8_env_observe(env, 4) == nullptr);
+  REQUIRE(chip8_env_reset_one(env, 4, 0) == -1);
+  REQUIRE(chip8_env_hires(env, 4) == -1);
+
+  chip8_env_destroy(env);
+}
+
+TEST_CASE("Observations keep 64x32 frames and scale hires ones", "[ENV]") {
+  VecEnv vec(2, 1);
+  REQUIRE(vec.LoadRom(ROM, sizeof(ROM)));
+  vec.Reset(1);
+
+  CHIP8 &lores = vec.Env(0), &hires = vec.Env(1);
+  lores.screen.buffer[5] = 0xC000000000000001ULL; // Pixels 0, 1 and 63
+  hires.screen.SetHires(true);
+  hires.screen.buffer[2 * 11] = 0x4000000000000000ULL;     // (1, 11)
+  hires.screen.buffer[2 * 20 + 1] = 0x0000000000000001ULL; // (127, 20)
+
+  uint64_t all[2 * VecEnv::OBSERVATION_WORDS];
+  vec.ObserveAll(all);
+  REQUIRE(all[5] == 0xC000000000000001ULL);
+  const uint64_t *halved = all + VecEnv::OBSERVATION_WORDS;
+  for (size_t y = 0; y < VecEnv::OBSERVATION_WORDS; y++) {
+    uint64_t expected = y == 5 ? 0x8000000000000000ULL
+                        : y == 10 ? 0x0000000000000001ULL : 0;
+    INFO("row " << y);
+    REQUIRE(halved[y] == expected);
+  }
+
+  std::vector<uint64_t> big(2 * VecEnv::HIRES_OBSERVATION_WORDS);
+  vec.ObserveAllHires(big.data());
+  REQUIRE(memcmp(&big[VecEnv::HIRES_OBSERVATION_WORDS], hires.screen.buffer,
+                 sizeof(hires.screen.buffer)) == 0);
+  // Lores pixel 0 and 1 cover hires 0-3, pixel 63 hires 126-127
+  REQUIRE(big[2 * 10] == 0xF000000000000000ULL);
+  REQUIRE(big[2 * 11 + 1] == 0x0000000000000003ULL);
+  REQUIRE(big[2 * 12] == 0);
+}